@@ -27,6 +27,7 @@ elif [[ ${build} == "clean" ]]; then
 	rm -rf build ||:
 	rm -rf idf ||:
 	rm -rf lexrank ||:
+	rm -rf lexrank_server ||:
 	rm -rf doc ||:
 	exit
 elif [[ ${build} == "doc" ]]; then
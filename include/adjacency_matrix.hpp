@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Bit-packed adjacency matrix of an undirected graph.
+ *
+ * Each entry is stored as a single bit, and each row is stored as a
+ * contiguous sequence of 64-bit words. Hence, the matrix takes 8 times less
+ * memory than a matrix of chars, the degree of a node is computed by counting
+ * the set bits of its row a word at a time, and the neighbors of a node are
+ * enumerated by skipping whole words of zeros.
+ *
+ * Since the graph is undirected, setting an edge sets both \f$X_{ij}\f$ and
+ * \f$X_{ji}\f$, and rows and columns are the same.
+ */
+class AdjacencyMatrix {
+  public:
+    /**
+     * @brief Number of bits in a word.
+     */
+    static constexpr size_t WordBits = 64;
+
+    /**
+     * @brief Default constructor constructing an empty matrix.
+     */
+    AdjacencyMatrix() = default;
+
+    /**
+     * @brief Construct an n by n matrix with no edges.
+     *
+     * @param n Number of nodes.
+     */
+    explicit AdjacencyMatrix(size_t n)
+        : m_n(n), m_words_per_row((n + WordBits - 1) / WordBits),
+          m_words(n * m_words_per_row, 0) {}
+
+    /**
+     * @brief Add an edge between nodes i and j.
+     *
+     * @param i First node.
+     * @param j Second node.
+     */
+    void set(size_t i, size_t j) {
+        set_bit(i, j);
+        set_bit(j, i);
+    }
+
+    /**
+     * @brief Return whether there is an edge between nodes i and j.
+     *
+     * @param i First node.
+     * @param j Second node.
+     * @return true if the nodes are adjacent; false, otherwise.
+     */
+    bool test(size_t i, size_t j) const {
+        assert(i < m_n && j < m_n);
+        return (row(i)[j / WordBits] >> (j % WordBits)) & 1;
+    }
+
+    /**
+     * @brief Return the number of neighbors of the given node.
+     *
+     * @param i Node.
+     * @return Degree of the node, counting a self loop once.
+     */
+    size_t degree(size_t i) const {
+        const std::uint64_t* words = row(i);
+        size_t result = 0;
+        for (size_t w = 0; w < m_words_per_row; ++w) {
+            result += __builtin_popcountll(words[w]);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Call the given function with every neighbor of the given node in
+     * increasing order.
+     *
+     * @tparam Function Function type callable with a size_t.
+     * @param i Node.
+     * @param f Function to call with each neighbor.
+     */
+    template <typename Function>
+    void for_each_neighbor(size_t i, Function&& f) const {
+        const std::uint64_t* words = row(i);
+        for (size_t w = 0; w < m_words_per_row; ++w) {
+            std::uint64_t word = words[w];
+            while (word != 0) {
+                f(w * WordBits + __builtin_ctzll(word));
+                // clear the lowest set bit
+                word &= word - 1;
+            }
+        }
+    }
+
+    /**
+     * @brief Return the number of nodes.
+     *
+     * @return Number of rows (and columns) of the matrix.
+     */
+    size_t rows() const { return m_n; }
+
+    /**
+     * @brief Return the number of nodes.
+     *
+     * @return Number of rows (and columns) of the matrix.
+     */
+    size_t cols() const { return m_n; }
+
+    /**
+     * @brief Return the total number of set entries, i.e. the sum of degrees.
+     *
+     * @return Number of set entries.
+     */
+    size_t entries() const {
+        size_t result = 0;
+        for (const std::uint64_t word : m_words) {
+            result += __builtin_popcountll(word);
+        }
+        return result;
+    }
+
+  private:
+    /**
+     * @brief Set only entry \f$X_{ij}\f$.
+     */
+    void set_bit(size_t i, size_t j) {
+        assert(i < m_n && j < m_n);
+        m_words[i * m_words_per_row + j / WordBits] |= std::uint64_t(1)
+                                                       << (j % WordBits);
+    }
+
+    /**
+     * @brief Return pointer to the first word of the given row.
+     */
+    const std::uint64_t* row(size_t i) const {
+        assert(i < m_n);
+        return m_words.data() + i * m_words_per_row;
+    }
+
+    /**
+     * @brief Number of nodes.
+     */
+    size_t m_n = 0;
+
+    /**
+     * @brief Number of words storing each row.
+     */
+    size_t m_words_per_row = 0;
+
+    /**
+     * @brief Rows stored contiguously one after another.
+     */
+    std::vector<std::uint64_t> m_words;
+};
+
+} // namespace ir
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "count_min_sketch.hpp"
+#include "document_frequencies.hpp"
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Approximate number of bytes used by one term of the heavy hitter
+ * table of an ir::ApproximateDocumentFrequencies, including the hash table
+ * node and the heap entry.
+ */
+const size_t HeavyHitterBytes = 96;
+
+/**
+ * @brief Approximate document frequencies of the most frequent terms of a
+ * document corpus, counted in a fixed amount of memory.
+ *
+ * Every term is counted in an ir::CountMinSketch. Additionally, a heavy
+ * hitter table stores up to a fixed number of terms with the largest counts
+ * together with their counts. A term that isn't in the table enters it when
+ * its sketch estimate exceeds the smallest count in the table, replacing
+ * the term with that count, and from then on it is counted exactly in the
+ * table. Hence, the count of a term in the table exceeds its document
+ * frequency by at most the error of the sketch when it entered the table
+ * (see CountMinSketch::error_bound). Until the first term is left out of
+ * the table, every term is counted from its first occurrence, so the counts
+ * are exact.
+ *
+ * Half of the memory budget is used for the sketch and the other half for
+ * the table. The memory doesn't grow with the number of distinct terms; only
+ * the terms in the table are kept (see document_frequencies).
+ */
+class ApproximateDocumentFrequencies {
+  public:
+    /**
+     * @brief Construct an object with no documents.
+     *
+     * @param memory_budget Number of bytes of the sketch and the table.
+     *
+     * @throw std::invalid_argument if the budget is too small for a sketch
+     * and a table.
+     */
+    explicit ApproximateDocumentFrequencies(size_t memory_budget);
+
+    /**
+     * @brief Move constructor.
+     */
+    ApproximateDocumentFrequencies(ApproximateDocumentFrequencies&&) = default;
+
+    /**
+     * @brief Move assignment operator.
+     */
+    ApproximateDocumentFrequencies&
+    operator=(ApproximateDocumentFrequencies&&) = default;
+
+    /**
+     * @brief Copying is disabled since the heap points into the table.
+     */
+    ApproximateDocumentFrequencies(const ApproximateDocumentFrequencies&) =
+        delete;
+
+    /**
+     * @brief Copying is disabled since the heap points into the table.
+     */
+    ApproximateDocumentFrequencies&
+    operator=(const ApproximateDocumentFrequencies&) = delete;
+
+    /**
+     * @brief Count the given terms of a document once.
+     *
+     * @param doc_terms Distinct normalized terms of a document.
+     */
+    void add(const std::vector<std::string>& doc_terms);
+
+    /**
+     * @brief Add the counts of another object to this object.
+     *
+     * Terms of both tables are kept, and the count of a term missing from a
+     * table is estimated by the sketch of that table's object, so the counts
+     * still never underestimate. The capacity of the table grows by the
+     * capacity of the other table.
+     *
+     * @param other Object constructed with the same memory budget.
+     */
+    void merge(const ApproximateDocumentFrequencies& other);
+
+    /**
+     * @brief Return the terms of the heavy hitter table with their counts.
+     *
+     * @return Document frequencies of the terms in the table with sorted
+     * terms (see DocumentFrequencies::sort_terms). The result is pruned if
+     * any term was left out of the table, and the terms left out occur in
+     * at most missing_df() documents.
+     */
+    DocumentFrequencies document_frequencies() const;
+
+    /**
+     * @brief Return the sketch counting every term.
+     *
+     * @return const-reference to the sketch.
+     */
+    const CountMinSketch& sketch() const { return m_sketch; }
+
+    /**
+     * @brief Return the maximum number of terms in the heavy hitter table.
+     *
+     * @return Capacity of the table.
+     */
+    size_t capacity() const { return m_capacity; }
+
+    /**
+     * @brief Return the number of objects merged into this object, including
+     * itself.
+     *
+     * @return Number of sketches whose counts this object holds.
+     */
+    size_t n_parts() const { return m_n_parts; }
+
+    /**
+     * @brief Return an upper bound of the document frequency of the terms
+     * left out of the heavy hitter table.
+     *
+     * A term is left out only when its count in the sketch, which never
+     * underestimates, doesn't exceed the smallest count in the table, and a
+     * replaced term has the smallest count in the table. Hence, the largest
+     * such count bounds the document frequency of every term left out.
+     *
+     * @return Upper bound of the document frequency of the terms left out; 0
+     * if no term is left out.
+     */
+    size_t missing_df() const { return m_missing_df; }
+
+    /**
+     * @brief Return the number of documents counted.
+     *
+     * @return Number of documents.
+     */
+    size_t n_docs() const { return m_n_docs; }
+
+  private:
+    /**
+     * @brief Count and heap position of a term in the heavy hitter table.
+     */
+    struct HeavyHitter {
+        size_t count;
+        size_t heap_index;
+    };
+
+    using Table = std::unordered_map<std::string, HeavyHitter>;
+
+    /**
+     * @brief Return whether the first entry should be replaced before the
+     * second one. Ties are broken by the terms to stay deterministic.
+     */
+    static bool evicted_before(const Table::value_type* left,
+                               const Table::value_type* right);
+
+    /**
+     * @brief Move the heap entry at the given index down until the heap is
+     * ordered again.
+     */
+    void sift_down(size_t index);
+
+    /**
+     * @brief Move the heap entry at the given index up until the heap is
+     * ordered again.
+     */
+    void sift_up(size_t index);
+
+    /**
+     * @brief Sketch counting every term.
+     */
+    CountMinSketch m_sketch;
+
+    /**
+     * @brief Maximum number of terms in m_table.
+     */
+    size_t m_capacity;
+
+    /**
+     * @brief Heavy hitter table.
+     */
+    Table m_table;
+
+    /**
+     * @brief Entries of m_table in a min-heap ordered by evicted_before, so
+     * that the entry to replace is at the top.
+     */
+    std::vector<Table::value_type*> m_heap;
+
+    /**
+     * @brief Whether any term was left out of m_table or replaced in it.
+     */
+    bool m_dropped = false;
+
+    /**
+     * @brief Upper bound of the document frequency of the terms left out of
+     * m_table.
+     */
+    size_t m_missing_df = 0;
+
+    /**
+     * @brief Number of objects merged into this object.
+     */
+    size_t m_n_parts = 1;
+
+    /**
+     * @brief Number of documents counted.
+     */
+    size_t m_n_docs = 0;
+};
+
+/**
+ * @brief Parse, normalize and approximately count the document frequencies
+ * of all documents in the given file list using multiple threads.
+ *
+ * The file list is split into contiguous slices, one per thread. Each thread
+ * counts its slice in an ir::ApproximateDocumentFrequencies object using an
+ * equal share of the memory budget, and the objects are merged at the end.
+ * The result depends on the number of threads, but not on their timing.
+ *
+ * Each thread normalizes documents using a vocabulary that is discarded
+ * whenever it grows beyond a fixed size, so the memory used for
+ * normalization doesn't grow with the number of distinct terms either.
+ *
+ * @param file_list List of document files.
+ * @param n_threads Number of threads to use. If 0, the number of hardware
+ * threads is used.
+ * @param memory_budget Number of bytes of all sketches and tables.
+ * @param term_stats If not nullptr, the counters of the token caches of all
+ * threads are added here.
+ * @return Approximate document frequencies of the corpus.
+ *
+ * @throw std::invalid_argument if the budget is too small for a sketch and a
+ * table per thread.
+ * @throw std::runtime_error if a document file can't be read.
+ */
+ApproximateDocumentFrequencies corpus_approximate_document_frequencies(
+    const std::vector<std::string>& file_list, size_t n_threads,
+    size_t memory_budget, TermCacheStats* term_stats = nullptr);
+
+/**
+ * @brief Count the exact document frequencies of the given terms in all
+ * documents in the given file list using multiple threads.
+ *
+ * Only the given terms are counted, so the memory doesn't depend on the
+ * vocabulary of the corpus. This is used to measure the error of
+ * ir::corpus_approximate_document_frequencies on a sample of terms.
+ *
+ * @param file_list List of document files.
+ * @param terms Sorted normalized terms to count.
+ * @param n_threads Number of threads to use. If 0, the number of hardware
+ * threads is used.
+ * @return Document frequency of each term at the index of the term.
+ *
+ * @throw std::runtime_error if a document file can't be read.
+ */
+std::vector<size_t>
+term_document_frequencies(const std::vector<std::string>& file_list,
+                          const std::vector<std::string>& terms,
+                          size_t n_threads);
+
+} // namespace ir
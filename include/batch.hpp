@@ -0,0 +1,126 @@
+#pragma once
+
+#include "document_cache.hpp"
+#include "idf_model.hpp"
+#include "lexrank.hpp"
+#include "summarizer.hpp"
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Default maximum number of documents of ir::summarize_files and
+ * ir::summarize_jsonl that are being summarized or waiting to be written.
+ */
+const size_t DefaultBatchWindow = 1024;
+
+/**
+ * @brief Options of batch summarization.
+ */
+struct BatchOptions {
+    /**
+     * @brief Number of worker threads. If 0, the number of hardware threads
+     * is used.
+     */
+    size_t n_threads = 0;
+
+    /**
+     * @brief Number of summary sentences of each document.
+     */
+    size_t top_k = SummarySentenceCount;
+
+    /**
+     * @brief Maximum number of documents that are being summarized or whose
+     * results are waiting for the results of earlier documents. Bounds the
+     * memory used for reordering the results.
+     */
+    size_t window = DefaultBatchWindow;
+
+    /**
+     * @brief Graph and solver methods computing the LexRank scores.
+     */
+    LexrankOptions lexrank;
+
+    /**
+     * @brief Cache of normalized documents read by ir::summarize_files
+     * instead of normalizing documents whose contents didn't change; nullptr
+     * to normalize every document.
+     */
+    const DocumentCache* cache = nullptr;
+};
+
+/**
+ * @brief Statistics of batch summarization.
+ */
+struct BatchStats {
+    /**
+     * @brief Number of documents read.
+     */
+    size_t documents = 0;
+
+    /**
+     * @brief Number of documents that couldn't be summarized.
+     */
+    size_t failed = 0;
+
+    /**
+     * @brief Sums of the statistics of ir::GraphMethod::Approximate over all
+     * documents, with the recall estimated from the summed samples; default
+     * values for other graph methods.
+     */
+    LshStats lsh;
+
+    /**
+     * @brief Sums of the counters of the token caches of the workers (see
+     * ir::TermCache). Documents read from a document cache aren't
+     * normalized, so their tokens aren't counted.
+     */
+    TermCacheStats term_cache;
+};
+
+/**
+ * @brief Summarize every document file in the given list concurrently and
+ * write the results as JSON lines in the order of the list.
+ *
+ * Each worker thread repeatedly claims the next unclaimed document, and
+ * parses and summarizes it with the shared, read-only idf model. Hence, the
+ * workers stay busy regardless of the document sizes. Results are written
+ * by ir::write_summary_json (or ir::write_error_json if a document can't be
+ * read or summarized) with the file name as the document ID, and results of
+ * documents that finish early are buffered until all earlier results are
+ * written. Therefore, the output doesn't depend on the number of threads.
+ *
+ * @param file_list Paths of the document files (see ir::parse_doc_file).
+ * @param idf_model Model storing the vocabulary and idf scores of the corpus.
+ * @param os Output stream to write the results.
+ * @param options Batch options.
+ * @return Batch statistics.
+ */
+BatchStats summarize_files(const std::vector<std::string>& file_list,
+                           const IdfModel& idf_model, std::ostream& os,
+                           const BatchOptions& options = BatchOptions());
+
+/**
+ * @brief Summarize every JSON line document read from the given input
+ * stream concurrently and write the results as JSON lines in the input
+ * order.
+ *
+ * Documents are parsed with ir::parse_json_doc and empty lines are skipped.
+ * Documents are read only as fast as they are summarized, so the input can
+ * be arbitrarily long. Otherwise, the same as ir::summarize_files.
+ *
+ * @param is Input stream to read the documents.
+ * @param idf_model Model storing the vocabulary and idf scores of the corpus.
+ * @param os Output stream to write the results.
+ * @param options Batch options.
+ * @return Batch statistics.
+ */
+BatchStats summarize_jsonl(std::istream& is, const IdfModel& idf_model,
+                           std::ostream& os,
+                           const BatchOptions& options = BatchOptions());
+
+} // namespace ir
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Default number of rows of an ir::CountMinSketch.
+ */
+const size_t DefaultSketchDepth = 5;
+
+/**
+ * @brief A Count-Min sketch counting string keys in a fixed number of
+ * counters, using conservative updates.
+ *
+ * The sketch has \f$d\f$ rows of \f$w\f$ counters, and each key is hashed to
+ * one counter in every row. Adding a key increments only those of its
+ * counters that are equal to their minimum, and the estimate of a key is
+ * the minimum of its counters. Hence, estimates never underestimate, and the
+ * estimate of a key exceeds its true count by at most \f$\frac{e}{w} T\f$
+ * with probability at least \f$1 - e^{-d}\f$, where \f$T\f$ is the total
+ * number of additions (see error_bound).
+ *
+ * Sketches of the same dimensions can be merged by adding their counters.
+ * The estimates of the merged sketch never underestimate either.
+ */
+class CountMinSketch {
+  public:
+    /**
+     * @brief Construct an empty sketch.
+     *
+     * @param width Number of counters in each row. Rounded down to a power of
+     * two. Must be positive.
+     * @param depth Number of rows. Must be positive.
+     */
+    explicit CountMinSketch(size_t width, size_t depth = DefaultSketchDepth);
+
+    /**
+     * @brief Count one occurrence of the given key.
+     *
+     * @param key Key to count.
+     * @return Estimate of the count of the key after the addition.
+     */
+    size_t add(std::string_view key);
+
+    /**
+     * @brief Return the estimated count of the given key.
+     *
+     * @param key Key to look up.
+     * @return Estimate that is at least the true count of the key.
+     */
+    size_t estimate(std::string_view key) const;
+
+    /**
+     * @brief Add the counters of another sketch to this sketch.
+     *
+     * @param other Sketch with the same width and depth.
+     */
+    void merge(const CountMinSketch& other);
+
+    /**
+     * @brief Return the amount by which estimates exceed the true counts with
+     * probability at least \f$1 - e^{-d}\f$.
+     *
+     * @return \f$\frac{e}{w} T\f$.
+     */
+    double error_bound() const;
+
+    /**
+     * @brief Return the number of counters in each row.
+     *
+     * @return Width of the sketch.
+     */
+    size_t width() const { return m_mask + 1; }
+
+    /**
+     * @brief Return the number of rows.
+     *
+     * @return Depth of the sketch.
+     */
+    size_t depth() const { return m_depth; }
+
+    /**
+     * @brief Return the total number of additions.
+     *
+     * @return Total count.
+     */
+    size_t total() const { return m_total; }
+
+  private:
+    /**
+     * @brief Store the counter index of the given key in every row to
+     * indices.
+     */
+    void indices(std::string_view key, size_t* indices) const;
+
+    /**
+     * @brief Width of the sketch minus 1.
+     */
+    size_t m_mask;
+
+    /**
+     * @brief Number of rows.
+     */
+    size_t m_depth;
+
+    /**
+     * @brief Total number of additions.
+     */
+    size_t m_total = 0;
+
+    /**
+     * @brief Counters of the rows in row-major order.
+     */
+    std::vector<std::uint32_t> m_counters;
+};
+
+} // namespace ir
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "sparse.hpp"
+#include <atomic>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 /**
@@ -9,9 +11,78 @@
  */
 namespace ir {
 /**
- * @brief A map from terms to their counts.
+ * @brief Term IDs and counts of each sentence stored in CSR format.
  */
-using doc_terms = std::unordered_map<std::string, size_t>;
+using doc_terms = SparseRows<size_t>;
+
+/**
+ * @brief Identity of a term ID space, i.e. of the mapping from terms to IDs of
+ * a vocabulary or an idf model.
+ *
+ * Every object gets a generation number that is never reused within the
+ * process, unlike an address. A copy may assign IDs differently than the
+ * original afterwards, so it gets a new generation. A moved-to object takes
+ * over the generation, and the moved-from object gets a new one.
+ */
+class IdSpace {
+  public:
+    /**
+     * @brief Construct an ID space with a new generation.
+     */
+    IdSpace() : m_generation(next_generation()) {}
+
+    /**
+     * @brief Construct an ID space with a new generation.
+     */
+    IdSpace(const IdSpace&) : IdSpace() {}
+
+    /**
+     * @brief Take over the generation of other and give it a new one.
+     */
+    IdSpace(IdSpace&& other) noexcept : m_generation(other.m_generation) {
+        other.m_generation = next_generation();
+    }
+
+    /**
+     * @brief Take a new generation.
+     */
+    IdSpace& operator=(const IdSpace&) {
+        m_generation = next_generation();
+        return *this;
+    }
+
+    /**
+     * @brief Take over the generation of other and give it a new one.
+     */
+    IdSpace& operator=(IdSpace&& other) noexcept {
+        if (this != &other) {
+            m_generation = other.m_generation;
+            other.m_generation = next_generation();
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Return the generation number; never 0.
+     *
+     * @return Generation number.
+     */
+    std::uint64_t generation() const { return m_generation; }
+
+  private:
+    /**
+     * @brief Return a generation number that wasn't returned before.
+     */
+    static std::uint64_t next_generation() {
+        static std::atomic<std::uint64_t> counter(0);
+        return ++counter;
+    }
+
+    /**
+     * @brief Generation number.
+     */
+    std::uint64_t m_generation;
+};
 
 /**
  * @brief A class representing a raw (non-tokenized/non-normalized) document.
@@ -48,13 +119,15 @@ struct RawDocument {
 /**
  * @brief A class representing a tokenized and normalized document.
  *
- * Each sentence in a normalized document consists of normalized terms.
+ * Each sentence in a normalized document consists of normalized terms. Terms
+ * and counts of all sentences are stored in a single ir::SparseRows object
+ * where each row is a sentence sorted by term ID.
  */
 struct NormalizedDocument {
     /**
      * @brief Type of the sentences that make up a normalized document.
      */
-    using sentence = doc_terms;
+    using sentence = SparseRow<size_t>;
 
     /**
      * @brief Default constructor.
@@ -66,17 +139,17 @@ struct NormalizedDocument {
     /**
      * @brief Constructor that initializes a document with the given sentences.
      *
-     * @param sentence_term_counts Vector of sentences that make up the document
-     * text.
+     * @param sentence_term_counts Terms and counts of the sentences that make
+     * up the document text.
      */
-    explicit NormalizedDocument(std::vector<sentence> sentence_term_counts)
+    explicit NormalizedDocument(doc_terms sentence_term_counts)
         : sentence_term_counts(std::move(sentence_term_counts)) {}
 
     /**
-     * @brief Vector storing terms and counts for each sentence that make
-     * up the document text.
+     * @brief Terms and counts for each sentence that make up the document
+     * text. Each row corresponds to a sentence.
      */
-    std::vector<sentence> sentence_term_counts;
+    doc_terms sentence_term_counts;
 };
 
 } // namespace ir
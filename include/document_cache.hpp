@@ -0,0 +1,374 @@
+#pragma once
+
+#include "defs.hpp"
+#include "vocabulary.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Version of the binary document cache format written by
+ * ir::DocumentCacheWriter.
+ */
+const std::uint32_t DocumentCacheVersion = 2;
+
+/**
+ * @brief Index returned by ir::DocumentCache::find for documents that aren't
+ * in the cache.
+ */
+const size_t NoCachedDocument = std::numeric_limits<size_t>::max();
+
+/**
+ * @brief Return the hash identifying the contents of a document file.
+ *
+ * @param contents Contents of the file.
+ * @return Hash of the contents.
+ */
+std::uint64_t content_hash(std::string_view contents);
+
+/**
+ * @brief Record of a document in the documents section of a document cache.
+ */
+struct DocumentRecord {
+    /**
+     * @brief Hash of the contents of the document (see ir::content_hash).
+     */
+    std::uint64_t hash;
+
+    /**
+     * @brief Offset of the name of the document in the string pool.
+     */
+    std::uint64_t name_offset;
+
+    /**
+     * @brief Length of the name of the document.
+     */
+    std::uint64_t name_size;
+
+    /**
+     * @brief Offset of the block of the document in the document data, in
+     * 32-bit words.
+     */
+    std::uint64_t data_offset;
+
+    /**
+     * @brief Number of sentences of the document.
+     */
+    std::uint64_t n_sentences;
+
+    /**
+     * @brief Number of entries of all sentences of the document.
+     */
+    std::uint64_t n_entries;
+};
+
+/**
+ * @brief A read-only cache of normalized documents stored in the binary
+ * document cache format.
+ *
+ * The cache stores the terms and counts of every sentence of a set of
+ * documents exactly as ir::normalize_document produces them, so that
+ * documents whose text didn't change needn't be tokenized, normalized and
+ * stemmed again. Each document is keyed by its name (file name) and the hash
+ * of its contents (see ir::content_hash); a document is found only if both
+ * match.
+ *
+ * The binary format consists of the following sections, each starting at an 8
+ * byte aligned offset. All integers are stored in host byte order.
+ *
+ * 1. Header: magic bytes, format version, hash of the stopword list the
+ *    documents were normalized with (see ir::stopwords_fingerprint), number
+ *    of documents \f$D\f$ and terms \f$T\f$, and size of the document data
+ *    and of the string pool.
+ * 2. Document data: 32-bit words holding a block for each document, made of
+ *    the number of entries of each sentence followed by the entries of all
+ *    its sentences as pairs of term ID and count.
+ * 3. Documents: \f$D\f$ records (see ir::DocumentRecord) sorted by name.
+ * 4. Term offsets: \f$T + 1\f$ 64-bit offsets into the string pool.
+ * 5. String pool: concatenated term strings followed by document names.
+ *
+ * Since the document data precedes everything whose size depends on all
+ * documents, a cache is written one document at a time (see
+ * ir::DocumentCacheWriter).
+ *
+ * Term IDs in the cache are the cache's own. A cached document is converted
+ * to the IDs of any vocabulary by looking its terms up by their strings.
+ *
+ * Like ir::IdfModel, a cache file is memory-mapped and queried in place.
+ */
+class DocumentCache {
+  public:
+    /**
+     * @brief Construct an empty cache.
+     */
+    DocumentCache() = default;
+
+    /**
+     * @brief Memory-map the binary document cache file at the given path.
+     *
+     * The term offsets and the document records and data are checked once,
+     * in time linear in the size of the file, so that reading documents of
+     * a corrupt or truncated file can't read out of bounds.
+     *
+     * @param filepath Path to the document cache file.
+     *
+     * @throw std::runtime_error if the file can't be mapped, is not a valid
+     * document cache of version ir::DocumentCacheVersion, or was built with a
+     * different stopword list, or is corrupt.
+     */
+    explicit DocumentCache(const std::string& filepath);
+
+    /**
+     * @brief Move constructor.
+     *
+     * @param other Cache to move from.
+     */
+    DocumentCache(DocumentCache&& other) noexcept;
+
+    /**
+     * @brief Move assignment operator.
+     *
+     * @param other Cache to move from.
+     * @return Reference to this cache.
+     */
+    DocumentCache& operator=(DocumentCache&& other) noexcept;
+
+    DocumentCache(const DocumentCache&) = delete;
+    DocumentCache& operator=(const DocumentCache&) = delete;
+
+    /**
+     * @brief Unmap the cache file, if any.
+     */
+    ~DocumentCache();
+
+    /**
+     * @brief Return the index of the document with the given name and
+     * content hash.
+     *
+     * @param name Name of the document.
+     * @param hash Hash of the current contents of the document.
+     * @return Index of the document; ir::NoCachedDocument if there is no
+     * document with the name, or its contents changed.
+     */
+    size_t find(std::string_view name, std::uint64_t hash) const;
+
+    /**
+     * @brief Return the cached document at the given index normalized with
+     * the given vocabulary.
+     *
+     * The result is the same as normalizing the document with
+     * ir::normalize_document and the given vocabulary, except that terms
+     * missing from the vocabulary may be inserted in a different order.
+     *
+     * @param index Index of the document. Must be less than size().
+     * @param vocab Vocabulary used to map the terms to their IDs. Terms not
+     * in the vocabulary are inserted.
+     * @return Normalized document.
+     */
+    NormalizedDocument document(size_t index, Vocabulary& vocab) const;
+
+    /**
+     * @brief Return the cached document at the given index normalized with
+     * the given vocabulary, translating cache term IDs through the given
+     * table.
+     *
+     * The table remembers the vocabulary ID of every cache term looked up so
+     * far, so that documents read with the same vocabulary don't look the
+     * same terms up again. Vocabulary IDs never change, so the table stays
+     * valid as long as it is used with the same vocabulary.
+     *
+     * Only IDs less than n_shared are remembered. Vocabularies layered over
+     * the same ir::IdfModel share the IDs of the model terms, so with
+     * n_shared set to the number of model terms, one table can be used for
+     * all of them.
+     *
+     * @param index Index of the document. Must be less than size().
+     * @param vocab Vocabulary used to map the terms to their IDs. Terms not
+     * in the vocabulary are inserted.
+     * @param term_ids Vocabulary ID of each cache term ID. Must be empty or
+     * previously used with this cache and vocab (or a vocabulary sharing its
+     * first n_shared IDs).
+     * @param n_shared Number of vocabulary IDs that are remembered.
+     * @return Normalized document.
+     */
+    NormalizedDocument document(size_t index, Vocabulary& vocab,
+                                std::vector<term_id>& term_ids,
+                                size_t n_shared = InvalidTermID) const;
+
+    /**
+     * @brief Return the number of documents in the cache.
+     *
+     * @return Number of documents.
+     */
+    size_t size() const { return m_n_docs; }
+
+  private:
+    /**
+     * @brief Return the cached document at the given index with each cache
+     * term ID mapped by the given function.
+     *
+     * @param index Index of the document.
+     * @param to_id Function returning the term ID of a cache term ID.
+     * @return Normalized document.
+     */
+    template <typename ToID>
+    NormalizedDocument document_with(size_t index, ToID to_id) const;
+
+    /**
+     * @brief Return the string of the given cache term ID.
+     */
+    std::string_view term(std::uint32_t cache_id) const {
+        return std::string_view(m_strings + m_term_offsets[cache_id],
+                                m_term_offsets[cache_id + 1] -
+                                    m_term_offsets[cache_id]);
+    }
+
+    /**
+     * @brief Set the section pointers from the mapped file.
+     *
+     * @param n_bytes Size of the file in bytes.
+     */
+    void init_sections(size_t n_bytes);
+
+    /**
+     * @brief Return the name of the given document.
+     */
+    std::string_view name(const DocumentRecord& doc) const {
+        return std::string_view(m_strings + doc.name_offset, doc.name_size);
+    }
+
+    /**
+     * @brief Beginning of the mapped file.
+     */
+    const char* m_data = nullptr;
+
+    /**
+     * @brief Size of the memory mapping; 0 if no file is mapped.
+     */
+    size_t m_mapped_size = 0;
+
+    /**
+     * @brief Number of documents.
+     */
+    size_t m_n_docs = 0;
+
+    /**
+     * @brief Number of terms.
+     */
+    size_t m_n_terms = 0;
+
+    /**
+     * @brief Documents section.
+     */
+    const DocumentRecord* m_docs = nullptr;
+
+    /**
+     * @brief Document data section.
+     */
+    const std::uint32_t* m_data_words = nullptr;
+
+    /**
+     * @brief Term offsets section.
+     */
+    const std::uint64_t* m_term_offsets = nullptr;
+
+    /**
+     * @brief String pool section.
+     */
+    const char* m_strings = nullptr;
+};
+
+/**
+ * @brief Writer of a document cache in the binary format described in
+ * ir::DocumentCache, one document at a time.
+ *
+ * The block of each document is written to the output stream as soon as
+ * the document is added, so only the document names, the records and the
+ * terms are kept in memory. Documents may be added in any order; they are
+ * sorted by name when the cache is finished. Term IDs of the cache are
+ * assigned in the order in which the terms are first written.
+ *
+ * Documents are normalized with the current stopword list.
+ */
+class DocumentCacheWriter {
+  public:
+    /**
+     * @brief Start writing a document cache to the given output stream.
+     *
+     * @param os Binary output stream to write the cache. It must be
+     * seekable since the header is written last.
+     */
+    explicit DocumentCacheWriter(std::ostream& os);
+
+    DocumentCacheWriter(const DocumentCacheWriter&) = delete;
+    DocumentCacheWriter& operator=(const DocumentCacheWriter&) = delete;
+
+    /**
+     * @brief Write the given normalized document.
+     *
+     * The table remembers the cache term ID of every term of vocab written
+     * so far, so that documents normalized with the same vocabulary don't
+     * look the same terms up again.
+     *
+     * @param name Name of the document, distinct from the names of the
+     * documents written before.
+     * @param hash Hash of the contents of the document (see
+     * ir::content_hash).
+     * @param doc Document normalized with vocab.
+     * @param vocab Vocabulary of doc.
+     * @param term_ids Cache term ID of each term ID of vocab. Must be empty
+     * or previously used with this writer and vocab.
+     */
+    void add(std::string_view name, std::uint64_t hash,
+             const NormalizedDocument& doc, const Vocabulary& vocab,
+             std::vector<term_id>& term_ids);
+
+    /**
+     * @brief Write the document records, the terms and the header.
+     *
+     * No document can be added afterwards.
+     *
+     * @return Output stream of the cache.
+     */
+    std::ostream& finish();
+
+  private:
+    /**
+     * @brief Output stream of the cache.
+     */
+    std::ostream& m_os;
+
+    /**
+     * @brief Terms of the cache.
+     */
+    Vocabulary m_vocab;
+
+    /**
+     * @brief Record of each document written, with the name offset relative
+     * to m_names.
+     */
+    std::vector<DocumentRecord> m_records;
+
+    /**
+     * @brief Concatenated names of the documents written.
+     */
+    std::string m_names;
+
+    /**
+     * @brief Number of 32-bit words of document data written.
+     */
+    size_t m_data_size = 0;
+
+    /**
+     * @brief Block of the current document; reused for every document.
+     */
+    std::vector<std::uint32_t> m_block;
+};
+
+} // namespace ir
@@ -0,0 +1,346 @@
+#pragma once
+
+#include "defs.hpp"
+#include "document_cache.hpp"
+#include "idf_model.hpp"
+#include "term_cache.hpp"
+#include "vocabulary.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Document frequency of every term of a document corpus together with
+ * the corpus vocabulary and the number of documents.
+ *
+ * Documents added to an object must be normalized using its own vocabulary
+ * (see vocab()). Objects built from different parts of a corpus, possibly
+ * with different vocabularies, can be combined using merge. Since idf models
+ * store the counts (see ir::IdfModel), a corpus can be updated incrementally
+ * by merging the counts of its model with the counts of a batch of documents
+ * to add or remove. Similarly, a corpus can be counted in shards by
+ * separate processes, each writing the counts of its shard as a model, and
+ * the shard models can be combined afterwards.
+ *
+ * Terms that are too rare can be pruned, and terms that are too common can
+ * be marked so that their idf score is 0. Since the counts of pruned terms
+ * are lost, the counts of a pruned object (or model) can't be updated or
+ * combined anymore.
+ */
+class DocumentFrequencies {
+  public:
+    /**
+     * @brief Default constructor constructing an object with no documents.
+     */
+    DocumentFrequencies() = default;
+
+    /**
+     * @brief Construct an object with the counts stored in the given model.
+     *
+     * Terms have the same IDs as in the model.
+     *
+     * @param model Model storing document frequencies.
+     *
+     * @throw std::runtime_error if the model doesn't have counts or is pruned.
+     */
+    explicit DocumentFrequencies(const IdfModel& model);
+
+    /**
+     * @brief Construct an object with the given counts.
+     *
+     * @param terms Distinct terms. Their IDs follow their order.
+     * @param doc_freqs Document frequency of each term at the index of the
+     * term.
+     * @param n_docs Number of documents.
+     * @param pruned Whether the counts of some terms are missing.
+     * @param missing_df Upper bound of the document frequency of the rare
+     * terms whose counts are missing (see missing_df()).
+     */
+    DocumentFrequencies(const std::vector<std::string>& terms,
+                        const std::vector<size_t>& doc_freqs, size_t n_docs,
+                        bool pruned = false, size_t missing_df = 0);
+
+    /**
+     * @brief Construct an object with the sum of the counts stored in the
+     * given models.
+     *
+     * The terms of every model must be sorted lexicographically (see
+     * sort_terms), so the models are combined by a k-way merge of their term
+     * sequences without looking terms up. The terms of the resulting object
+     * are sorted as well. The models must count disjoint sets of documents.
+     *
+     * @param models Models storing document frequencies with sorted terms.
+     *
+     * @throw std::runtime_error if a model doesn't have counts, is pruned or
+     * its terms aren't sorted.
+     */
+    explicit DocumentFrequencies(const std::vector<IdfModel>& models);
+
+    /**
+     * @brief Construct an object with the counts stored in the given model,
+     * updated with the counts of a batch of documents.
+     *
+     * The terms of the model and of the batch must be sorted
+     * lexicographically (see sort_terms), so they are combined by a linear
+     * merge of the two term sequences without looking terms up. The terms of
+     * the resulting object are sorted as well, and the terms whose count
+     * becomes 0 are removed.
+     *
+     * @param model Model storing document frequencies with sorted terms.
+     * @param batch Counts of the documents to add to the model, or of some
+     * of the documents counted by the model to remove from it, with sorted
+     * terms.
+     * @param remove Whether the counts of batch are subtracted from the
+     * model instead of added to it.
+     *
+     * @throw std::runtime_error if the model doesn't have counts, is pruned or
+     * its terms aren't sorted.
+     * @throw std::invalid_argument if the batch is removed and has a term or
+     * document that isn't counted by the model.
+     */
+    DocumentFrequencies(const IdfModel& model,
+                        const DocumentFrequencies& batch, bool remove = false);
+
+    /**
+     * @brief Count every distinct term of the given document once.
+     *
+     * @param doc Document normalized using vocab().
+     */
+    void add(const NormalizedDocument& doc);
+
+    /**
+     * @brief Add the counts of another object to this object.
+     *
+     * Terms are matched by their strings; hence, the two objects may use
+     * different vocabularies. Terms missing from this object are appended to
+     * its vocabulary.
+     *
+     * @param other Object whose counts will be added.
+     */
+    void merge(const DocumentFrequencies& other);
+
+    /**
+     * @brief Reassign term IDs so that they follow the lexicographical order
+     * of the terms.
+     *
+     * This makes the vocabulary (and any file written from it) independent of
+     * the order in which documents were added and objects were merged. Terms
+     * that occur in no document are removed.
+     */
+    void sort_terms();
+
+    /**
+     * @brief Remove the terms occurring in fewer than min_df documents, mark
+     * the terms occurring in more than max_df_ratio of the documents as too
+     * common, and sort the remaining terms (see sort_terms).
+     *
+     * If any term is removed or marked, the object becomes pruned. The
+     * removed terms are accounted for in missing_df(). The too common terms
+     * keep their counts, and their idf score is 0 (see common_df()), so they
+     * aren't mistaken for missing rare terms. Must be called after all
+     * counts are merged.
+     *
+     * @param min_df Minimum document frequency of the kept terms.
+     * @param max_df_ratio Maximum ratio of the documents containing a term
+     * that isn't too common to all documents.
+     */
+    void prune(size_t min_df, double max_df_ratio);
+
+    /**
+     * @brief Calculate idf value of every term.
+     *
+     * idf value of term \f$t\f$ is defined as
+     *
+     * \f[
+     *     \log_{10}{\frac{N}{df_t}}
+     * \f]
+     *
+     * where \f$N\f$ is the total number of documents in the corpus and
+     * \f$df_t\f$ is the number of documents containing term \f$t\f$. The
+     * idf score of terms marked too common by prune is 0.
+     *
+     * @return A vector storing idf score of each term at the index of its term
+     * ID.
+     */
+    std::vector<double> idf_scores() const;
+
+    /**
+     * @brief Return the vocabulary of the counted terms.
+     *
+     * @return Reference to the vocabulary.
+     */
+    Vocabulary& vocab() { return m_vocab; }
+
+    /**
+     * @brief Return the vocabulary of the counted terms.
+     *
+     * @return const-reference to the vocabulary.
+     */
+    const Vocabulary& vocab() const { return m_vocab; }
+
+    /**
+     * @brief Return the number of documents containing the given term.
+     *
+     * @param id ID of the term.
+     * @return Document frequency of the term.
+     */
+    size_t df(term_id id) const { return id < m_df.size() ? m_df[id] : 0; }
+
+    /**
+     * @brief Return the document frequency of each term.
+     *
+     * @return Vector storing the document frequency of each term at the index
+     * of its term ID.
+     */
+    const std::vector<size_t>& doc_freqs() const { return m_df; }
+
+    /**
+     * @brief Return the number of documents counted.
+     *
+     * @return Number of documents.
+     */
+    size_t n_docs() const { return m_n_docs; }
+
+    /**
+     * @brief Return whether the counts of some terms are missing or some
+     * terms are marked too common, because they are pruned or counted
+     * approximately.
+     *
+     * @return true if the object is pruned; false, otherwise.
+     */
+    bool pruned() const { return m_pruned; }
+
+    /**
+     * @brief Return an upper bound of the document frequency of the rare
+     * terms whose counts are missing, i.e. the terms left out by approximate
+     * counting or pruned by a minimum document frequency.
+     *
+     * This is used to weight terms missing from an idf model (see
+     * ir::IdfModel::oov_idf).
+     *
+     * @return Upper bound of the document frequency of the missing rare
+     * terms; 0 if no rare term is missing.
+     */
+    size_t missing_df() const { return m_missing_df; }
+
+    /**
+     * @brief Return the minimum document frequency of the terms marked too
+     * common by prune.
+     *
+     * Every term counted in at least this many documents is too common.
+     *
+     * @return Minimum document frequency of the too common terms; 0 if no
+     * term is marked.
+     */
+    size_t common_df() const { return m_common_df; }
+
+  private:
+    /**
+     * @brief Vocabulary of the counted terms.
+     */
+    Vocabulary m_vocab;
+
+    /**
+     * @brief Document frequency of each term at the index of its term ID.
+     */
+    std::vector<size_t> m_df;
+
+    /**
+     * @brief Index of the last document each term is counted for, so that
+     * every term is counted at most once per document.
+     */
+    std::vector<size_t> m_last_doc;
+
+    /**
+     * @brief Number of documents counted.
+     */
+    size_t m_n_docs = 0;
+
+    /**
+     * @brief Whether the counts of some terms are missing or some terms are
+     * marked too common.
+     */
+    bool m_pruned = false;
+
+    /**
+     * @brief Upper bound of the document frequency of the missing rare
+     * terms.
+     */
+    size_t m_missing_df = 0;
+
+    /**
+     * @brief Minimum document frequency of the too common terms; 0 if none
+     * is marked.
+     */
+    size_t m_common_df = 0;
+};
+
+/**
+ * @brief Normalized documents read from and written to document caches by
+ * ir::corpus_document_frequencies.
+ */
+struct CorpusCache {
+    /**
+     * @brief Cache to look documents up in before normalizing them; nullptr
+     * to normalize every document.
+     */
+    const DocumentCache* cache = nullptr;
+
+    /**
+     * @brief Writer every counted document is added to, e.g. of a new cache
+     * replacing cache if stale turns out true; nullptr to write none.
+     * Documents are added in no particular order while they are counted.
+     */
+    DocumentCacheWriter* writer = nullptr;
+
+    /**
+     * @brief Whether the cache doesn't hold exactly the counted documents,
+     * i.e. needs to be rewritten.
+     */
+    bool stale = false;
+
+    /**
+     * @brief Number of documents read from the cache.
+     */
+    size_t hits = 0;
+};
+
+/**
+ * @brief Parse, normalize and count the document frequencies of all documents
+ * in the given file list using multiple threads.
+ *
+ * The file list is split into contiguous slices, one per thread. Each thread
+ * parses and normalizes its slice with its own vocabulary and counts document
+ * frequencies; the per-thread counts are merged at the end and the terms are
+ * sorted (see DocumentFrequencies::sort_terms). Therefore, the result doesn't
+ * depend on the number of threads.
+ *
+ * Documents are streamed: each document is read, normalized, counted and
+ * discarded before the next one is read. Hence, memory usage depends on the
+ * vocabulary size and not on the corpus size.
+ *
+ * If a document cache is given, documents whose name and contents match a
+ * cached document are read from the cache instead of being parsed and
+ * normalized. If a cache writer is given, every document is added to it as
+ * soon as it is counted, so documents are still streamed.
+ *
+ * @param file_list List of document files.
+ * @param n_threads Number of threads to use. If 0, the number of hardware
+ * threads is used.
+ * @param corpus_cache Document cache to read and writer to write; nullptr to
+ * normalize every document and write none.
+ * @param term_stats If not nullptr, the counters of the token caches of all
+ * threads are added here.
+ * @return Document frequencies of the corpus with sorted terms.
+ *
+ * @throw std::runtime_error if a document file can't be read.
+ */
+DocumentFrequencies
+corpus_document_frequencies(const std::vector<std::string>& file_list,
+                            size_t n_threads,
+                            CorpusCache* corpus_cache = nullptr,
+                            TermCacheStats* term_stats = nullptr);
+
+} // namespace ir
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "defs.hpp"
+#include "idf_model.hpp"
+#include "vocabulary.hpp"
 #include <string>
 #include <vector>
 
@@ -12,14 +14,26 @@ namespace ir {
 const std::string DOCUMENT_EXTENSION = ".txt";
 
 /**
- * @brief Relative path from executable to text file containing stopwords.
+ * @brief File containing IDF score of every term.
  */
-const std::string STOPWORD_PATH = "stopwords.txt";
+const std::string IDF_FILEPATH = "idf.txt";
 
 /**
- * @brief File containing IDF score of every term.
+ * @brief File containing the vocabulary and IDF scores in the binary idf model
+ * format (see ir::IdfModel).
  */
-const std::string IDF_FILEPATH = "idf.txt";
+const std::string IDF_MODEL_FILEPATH = "idf.bin";
+
+/**
+ * @brief Return the idf model to use for summarization.
+ *
+ * If the binary model file at ir::IDF_MODEL_FILEPATH exists, it is
+ * memory-mapped. Otherwise, the text idf file at ir::IDF_FILEPATH is read and
+ * an in-memory model is built from it.
+ *
+ * @return idf model.
+ */
+IdfModel load_idf_model();
 
 /**
  * @brief Return a list of filepaths of documents under the given dataset
@@ -34,6 +48,24 @@ const std::string IDF_FILEPATH = "idf.txt";
  */
 std::vector<std::string> get_data_file_list(const std::string& dataset_dir);
 
+/**
+ * @brief Read the whole contents of the file at the given path.
+ *
+ * @param filepath Path to the file.
+ * @param contents String to store the contents in.
+ * @return true if the file is read successfully; false, otherwise.
+ */
+bool read_file(const std::string& filepath, std::string& contents);
+
+/**
+ * @brief Return the name of a document from its filepath, i.e. the part after
+ * the last slash.
+ *
+ * @param filepath Path to the document file.
+ * @return Document name.
+ */
+std::string doc_name_from_filepath(const std::string& filepath);
+
 /**
  * @brief Extract the ID of the document from its filepath.
  *
@@ -43,37 +75,45 @@ std::vector<std::string> get_data_file_list(const std::string& dataset_dir);
 size_t doc_id_from_filepath(const std::string& filepath);
 
 /**
- * @brief Write the given mapping from terms to their idf scores to the given
+ * @brief Write the idf score of every term in the given vocabulary to the given
  * output stream.
  *
- * The terms and their scores are written as follows:
+ * The terms and their scores are written in the order of their term IDs as
+ * follows:
  *
  * <blockquote>
+ * term_0 score_0\n
  * term_1 score_1\n
- * term_2 score_2\n
  * \f$\vdots\f$\n
- * term_N score_N\n
+ * term_{N-1} score_{N-1}\n
  * </blockquote>
  *
+ * Hence, the line number (0-based) of each term is its term ID, and the file
+ * can be used to restore the same vocabulary in another program.
+ *
  * @param os Output stream to write the term-idf mapping.
- * @param idf_scores Mapping from terms to their idf scores.
+ * @param vocab Vocabulary containing the terms.
+ * @param idf_scores Vector storing idf score of each term at the index of its
+ * term ID.
  * @return Modified output stream.
  */
-std::ostream&
-write_idf_file(std::ostream& os,
-               const std::unordered_map<std::string, double>& idf_scores);
+std::ostream& write_idf_file(std::ostream& os, const Vocabulary& vocab,
+                             const std::vector<double>& idf_scores);
 
 /**
- * @brief Read a term-idf mapping from the given input stream.
+ * @brief Read a vocabulary and its idf scores from the given input stream.
  *
  * The terms and their scores are read according to the format as specified in
- * ir::write_idf_file.
+ * ir::write_idf_file. Each term read is interned into the given vocabulary in
+ * the file order so that the term IDs are the same as those used by the
+ * program writing the file.
  *
  * @param is Input stream to read the term-idf mapping.
- * @param idf_scores Mapping to modify in-place and store the read mapping.
+ * @param vocab Vocabulary to modify in-place. Must be empty.
+ * @param idf_scores Vector to modify in-place and store the idf score of each
+ * term at the index of its term ID.
  * @return Modified input stream.
  */
-std::istream&
-read_idf_file(std::istream& is,
-              std::unordered_map<std::string, double>& idf_scores);
+std::istream& read_idf_file(std::istream& is, Vocabulary& vocab,
+                            std::vector<double>& idf_scores);
 } // namespace ir
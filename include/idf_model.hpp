@@ -0,0 +1,371 @@
+#pragma once
+
+#include "defs.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ir {
+
+class Vocabulary;
+
+/**
+ * @brief Version of the binary idf model format written by
+ * ir::write_idf_model.
+ */
+const std::uint32_t IdfModelVersion = 6;
+
+/**
+ * @brief A read-only vocabulary and idf table stored in the binary idf model
+ * format.
+ *
+ * The binary format consists of the following sections, each starting at an 8
+ * byte aligned offset. All integers are stored in host byte order.
+ *
+ * 1. Header: magic bytes, format version, number of terms \f$N\f$, number of
+ *    hash slots \f$S\f$ (a power of two), size of the string pool, number
+ *    of documents \f$D\f$ in the corpus, flags (whether the model stores
+ *    counts, and whether terms of the corpus are missing from the model), an
+ *    upper bound of the document frequency of the rare terms missing from
+ *    the model and the minimum document frequency of the terms marked too
+ *    common (0 if none is marked).
+ * 2. Term weights: \f$N\f$ 64-bit document frequencies indexed by term ID.
+ *    If the model doesn't store counts, the corpus counts are unknown and
+ *    the weights are \f$N\f$ precomputed idf scores (doubles) instead.
+ * 3. Term offsets: \f$N + 1\f$ 64-bit offsets into the string pool. Term
+ *    \f$i\f$ is in the half-open range \f$[offset_i, offset_{i+1})\f$.
+ * 4. Hash slots: \f$S\f$ term IDs (or ir::InvalidTermID for empty slots) of
+ *    an open addressing hash table with linear probing.
+ * 5. String pool: concatenated term strings.
+ *
+ * A model file is memory-mapped read-only and queried in place; nothing is
+ * parsed or copied when it is opened. Hence, opening a model takes the same
+ * time regardless of the vocabulary size, and processes using the same model
+ * file share its pages in the page cache.
+ *
+ * Models storing document frequencies compute idf scores lazily when they
+ * are queried. Hence, adding or removing documents only changes the counts
+ * of their terms and the document count (see ir::DocumentFrequencies).
+ *
+ * A model can also be built in memory from a vocabulary and idf scores, which
+ * is used when only a text idf file is available.
+ */
+class IdfModel {
+  public:
+    /**
+     * @brief Memory-map the binary idf model file at the given path.
+     *
+     * The term offsets and the hash table are checked once, in time linear
+     * in their size, so that lookups in a corrupt or truncated file can't
+     * read out of bounds.
+     *
+     * @param filepath Path to the binary idf model file.
+     *
+     * @throw std::runtime_error if the file can't be mapped or is not a valid
+     * idf model of version ir::IdfModelVersion.
+     */
+    explicit IdfModel(const std::string& filepath);
+
+    /**
+     * @brief Build an in-memory idf model from the given vocabulary and idf
+     * scores.
+     *
+     * @param vocab Vocabulary containing the terms.
+     * @param idf_scores Vector storing idf score of each term at the index of
+     * its term ID.
+     */
+    IdfModel(const Vocabulary& vocab, const std::vector<double>& idf_scores);
+
+    /**
+     * @brief Build an in-memory idf model from the given vocabulary and
+     * document frequencies.
+     *
+     * @param vocab Vocabulary containing the terms.
+     * @param doc_freqs Vector storing the number of documents containing each
+     * term at the index of its term ID. Every count must be positive.
+     * @param n_docs Number of documents in the corpus. May be 0 only if vocab
+     * is empty.
+     * @param pruned Whether terms of the corpus are missing from vocab.
+     * @param missing_df Upper bound of the document frequency of the rare
+     * terms of the corpus missing from vocab (see missing_df()).
+     * @param common_df Minimum document frequency of the terms marked too
+     * common (see common_df()); 0 if no term is marked.
+     */
+    IdfModel(const Vocabulary& vocab, const std::vector<size_t>& doc_freqs,
+             size_t n_docs, bool pruned = false, size_t missing_df = 0,
+             size_t common_df = 0);
+
+    /**
+     * @brief Move constructor.
+     *
+     * @param other Model to move from.
+     */
+    IdfModel(IdfModel&& other) noexcept;
+
+    /**
+     * @brief Move assignment operator.
+     *
+     * @param other Model to move from.
+     * @return Reference to this model.
+     */
+    IdfModel& operator=(IdfModel&& other) noexcept;
+
+    IdfModel(const IdfModel&) = delete;
+    IdfModel& operator=(const IdfModel&) = delete;
+
+    /**
+     * @brief Unmap the model file, if any.
+     */
+    ~IdfModel();
+
+    /**
+     * @brief Return the ID of the given term.
+     *
+     * @param term Normalized term.
+     * @return ID of the term if it is in the model; ir::InvalidTermID,
+     * otherwise.
+     */
+    term_id find(const std::string& term) const;
+
+    /**
+     * @brief Return the term with the given ID.
+     *
+     * @param id ID of the term. Must be less than size().
+     * @return Copy of the term string.
+     */
+    std::string term(term_id id) const;
+
+    /**
+     * @brief Return the idf score of the term with the given ID.
+     *
+     * If the model stores document frequencies, the score is computed from
+     * them as in ir::DocumentFrequencies::idf_scores; terms marked too
+     * common (see common_df()) score 0.
+     *
+     * @param id ID of the term.
+     * @return idf score of the term.
+     *
+     * @throw std::out_of_range if the ID is not less than size().
+     */
+    double idf(term_id id) const;
+
+    /**
+     * @brief Return the idf score assumed for terms missing from this model
+     * by ir::OovPolicy::MaxIdf.
+     *
+     * @return idf score of a term occurring in missing_df() documents (or a
+     * single document if no rare term is missing) if the model has counts
+     * of some documents; the largest idf score in the model, otherwise.
+     */
+    double oov_idf() const { return m_oov_idf; }
+
+    /**
+     * @brief Return whether this model stores document frequencies.
+     *
+     * A model with counts may count no documents, e.g. an empty shard of a
+     * corpus.
+     *
+     * @return true if df() and n_docs() are available; false, otherwise.
+     */
+    bool has_counts() const { return m_has_counts; }
+
+    /**
+     * @brief Return the number of documents containing the term with the
+     * given ID.
+     *
+     * @param id ID of the term. Must be less than size().
+     * @return Document frequency of the term. The model must have counts.
+     */
+    size_t df(term_id id) const;
+
+    /**
+     * @brief Return the number of documents in the corpus.
+     *
+     * @return Number of documents; 0 if the model doesn't have counts.
+     */
+    size_t n_docs() const { return m_n_docs; }
+
+    /**
+     * @brief Return whether terms of the corpus were left out of this model
+     * or marked too common, by pruning or by approximate counting.
+     *
+     * The counts of a pruned model can't be updated incrementally since the
+     * counts of the missing terms are lost (see ir::DocumentFrequencies).
+     *
+     * @return true if the model is pruned; false, otherwise.
+     */
+    bool pruned() const { return m_pruned; }
+
+    /**
+     * @brief Return an upper bound of the document frequency of the rare
+     * terms of the corpus missing from this model, i.e. the terms left out
+     * by approximate counting or pruned by a minimum document frequency
+     * (see ir::DocumentFrequencies::missing_df).
+     *
+     * @return Upper bound of the document frequency of the missing rare
+     * terms; 0 if no rare term is missing or the model doesn't have counts.
+     */
+    size_t missing_df() const { return m_missing_df; }
+
+    /**
+     * @brief Return the minimum document frequency of the terms marked too
+     * common by a maximum document frequency ratio (see
+     * ir::DocumentFrequencies::common_df).
+     *
+     * @return Minimum document frequency of the too common terms; 0 if no
+     * term is marked or the model doesn't have counts.
+     */
+    size_t common_df() const { return m_common_df; }
+
+    /**
+     * @brief Return the number of terms in this model.
+     *
+     * @return Number of terms.
+     */
+    size_t size() const { return m_n_terms; }
+
+    /**
+     * @brief Return the generation of the ID space of this model.
+     *
+     * @return Generation of the ID space (see ir::IdSpace).
+     */
+    std::uint64_t id_space() const { return m_id_space.generation(); }
+
+  private:
+    /**
+     * @brief Set the section pointers from the model image starting at m_data.
+     *
+     * @param n_bytes Size of the image in bytes.
+     */
+    void init_sections(size_t n_bytes);
+
+    /**
+     * @brief Beginning of the model image.
+     */
+    const char* m_data = nullptr;
+
+    /**
+     * @brief Size of the memory mapping; 0 if the image is owned in memory.
+     */
+    size_t m_mapped_size = 0;
+
+    /**
+     * @brief Storage of in-memory models (8-byte words for alignment).
+     */
+    std::vector<std::uint64_t> m_owned;
+
+    /**
+     * @brief Number of terms.
+     */
+    size_t m_n_terms = 0;
+
+    /**
+     * @brief Number of hash slots minus 1.
+     */
+    size_t m_slot_mask = 0;
+
+    /**
+     * @brief Number of documents; 0 if the model doesn't have counts.
+     */
+    size_t m_n_docs = 0;
+
+    /**
+     * @brief Whether the model stores document frequencies.
+     */
+    bool m_has_counts = false;
+
+    /**
+     * @brief Whether terms of the corpus are missing from the model.
+     */
+    bool m_pruned = false;
+
+    /**
+     * @brief Upper bound of the document frequency of the missing rare terms.
+     */
+    size_t m_missing_df = 0;
+
+    /**
+     * @brief Minimum document frequency of the too common terms; 0 if none
+     * is marked.
+     */
+    size_t m_common_df = 0;
+
+    /**
+     * @brief idf score of terms missing from the model.
+     */
+    double m_oov_idf = 0;
+
+    /**
+     * @brief Term weights section as idf scores; nullptr if the model has
+     * counts.
+     */
+    const double* m_idf = nullptr;
+
+    /**
+     * @brief Term weights section as document frequencies; nullptr if the
+     * model doesn't have counts.
+     */
+    const std::uint64_t* m_df = nullptr;
+
+    /**
+     * @brief Term offsets section.
+     */
+    const std::uint64_t* m_offsets = nullptr;
+
+    /**
+     * @brief Hash slots section.
+     */
+    const term_id* m_slots = nullptr;
+
+    /**
+     * @brief String pool section.
+     */
+    const char* m_strings = nullptr;
+
+    /**
+     * @brief Identity of the term IDs of the model.
+     */
+    IdSpace m_id_space;
+};
+
+/**
+ * @brief Write the given vocabulary and idf scores to the given output stream
+ * in the binary idf model format described in ir::IdfModel.
+ *
+ * Term IDs in the model are the same as those in the given vocabulary.
+ *
+ * @param os Binary output stream to write the model.
+ * @param vocab Vocabulary containing the terms.
+ * @param idf_scores Vector storing idf score of each term at the index of its
+ * term ID.
+ * @return Modified output stream.
+ */
+std::ostream& write_idf_model(std::ostream& os, const Vocabulary& vocab,
+                              const std::vector<double>& idf_scores);
+
+/**
+ * @brief Write the given vocabulary and document frequencies to the given
+ * output stream in the binary idf model format described in ir::IdfModel.
+ *
+ * Term IDs in the model are the same as those in the given vocabulary.
+ *
+ * @param os Binary output stream to write the model.
+ * @param vocab Vocabulary containing the terms.
+ * @param doc_freqs Vector storing the number of documents containing each
+ * term at the index of its term ID. Every count must be positive.
+ * @param n_docs Number of documents in the corpus. May be 0 only if vocab is
+ * empty.
+ * @param pruned Whether terms of the corpus are missing from vocab.
+ * @param missing_df Upper bound of the document frequency of the rare terms
+ * of the corpus missing from vocab (see ir::IdfModel::missing_df).
+ * @param common_df Minimum document frequency of the terms marked too common
+ * (see ir::IdfModel::common_df); 0 if no term is marked.
+ * @return Modified output stream.
+ */
+std::ostream& write_idf_model(std::ostream& os, const Vocabulary& vocab,
+                              const std::vector<size_t>& doc_freqs,
+                              size_t n_docs, bool pruned = false,
+                              size_t missing_df = 0, size_t common_df = 0);
+
+} // namespace ir
@@ -1,10 +1,18 @@
 #pragma once
 
+#include "adjacency_matrix.hpp"
 #include "defs.hpp"
+#include "idf_model.hpp"
 #include "matrix.hpp"
+#include "similarity_join.hpp"
+#include "solver.hpp"
+#include "sparse.hpp"
+#include "thread_pool.hpp"
+#include "transition_matrix.hpp"
 #include "util.hpp"
 #include "vector_space_model.hpp"
 #include <algorithm>
+#include <string>
 #include <vector>
 
 namespace ir {
@@ -19,30 +27,98 @@ namespace ir {
 const double LexrankEdgeThreshold = 0.1;
 
 /**
- * @brief Epsilon value that determines the convergence of power iteration.
- *
- * During power iteration, for vectors \f$x^t\f$ and \f$x^{t+1}\f$ where \f$t\f$
- * is iteration count, if
- *
- * \f[
- *     |x_i^t - x_i^{t+1}| \leq \epsilon \qquad \forall i
- * \f]
+ * @brief Damping factor of the LexRank algorithm (teleportation rate of the
+ * underlying Markov Chain).
+ */
+const double DampingFactor = 0.15;
+
+/**
+ * @brief Number of rows and columns of the tiles compared by a single task in
+ * the multi-threaded ir::build_adjacency_matrix.
  *
- * then it is assumed that power iteration has converged.
+ * Must be a multiple of ir::AdjacencyMatrix::WordBits so that every word of
+ * the adjacency matrix is written by a single tile.
  */
-const double PowerIterationEpsilon = 1e-5;
+const size_t GraphTileSize = 256;
+
+static_assert(GraphTileSize % AdjacencyMatrix::WordBits == 0,
+              "Graph tiles must consist of whole adjacency matrix words");
 
 /**
- * @brief Damping factor of the LexRank algorithm (teleportation rate of the
- * underlying Markov Chain).
+ * @brief Method used to build the sentence graph.
  */
-const double DampingFactor = 0.15;
+enum class GraphMethod {
+    /**
+     * @brief Compare every pair of sentences (see
+     * ir::build_adjacency_matrix).
+     */
+    Exhaustive,
+
+    /**
+     * @brief Compare the pairs found with an inverted index (see
+     * ir::build_adjacency_matrix_indexed).
+     */
+    Indexed,
+
+    /**
+     * @brief Compare the pairs found with locality-sensitive hashing; some
+     * edges may be missed (see ir::build_adjacency_matrix_approximate).
+     */
+    Approximate
+};
+
+/**
+ * @brief Options of the LexRank algorithm.
+ */
+struct LexrankOptions {
+    /**
+     * @brief Method used to build the sentence graph.
+     */
+    GraphMethod graph = GraphMethod::Indexed;
+
+    /**
+     * @brief Number of threads of ir::GraphMethod::Exhaustive. If 0, the
+     * number of hardware threads is used.
+     */
+    size_t graph_threads = 1;
+
+    /**
+     * @brief Parameters of ir::GraphMethod::Approximate.
+     */
+    LshOptions lsh;
+
+    /**
+     * @brief Solver computing the stationary distribution.
+     */
+    SolverOptions solver;
+
+    /**
+     * @brief Treatment of terms missing from the idf model.
+     */
+    OovPolicy oov = OovPolicy::Ignore;
+};
+
+/**
+ * @brief Statistics of the LexRank algorithm.
+ */
+struct LexrankStats {
+    /**
+     * @brief Statistics of the solver.
+     */
+    SolverStats solver;
+
+    /**
+     * @brief Statistics of ir::GraphMethod::Approximate; default values for
+     * the other methods.
+     */
+    LshStats lsh;
+};
 
 /**
  * @brief Build an adjacency matrix to be used in LexRank algorithm from the
  * tf-idf vectors of all sentences.
  *
- * tf-idf vectors of the sentences are taken as unordered maps to prevent
+ * tf-idf vectors of the sentences are taken as sparse rows to prevent
  * storing many 0 tf-idf values.
  *
  * In the adjacency matrix, if two sentences \f$i\f$ and \f$j\f$ have cosine
@@ -50,11 +126,67 @@ const double DampingFactor = 0.15;
  * be 1's in entries \f$X_{ij}\f$ and \f$X_{ji}\f$. All other entries in the
  * matrix are 0.
  *
- * @param tfidf_maps Vector storing tf-idf map of each sentence.
- * @return An ir::Matrix of chars having 0 or 1 as value.
+ * With multiple threads, the upper triangle of the matrix is split into
+ * square tiles of ir::GraphTileSize sentences, and the tiles are compared by
+ * a thread pool. Off-diagonal tiles are submitted before the diagonal tiles,
+ * which have half as many pairs, so that the threads finish at about the same
+ * time. The edges of a tile and their mirrors are stored in words that no
+ * other tile writes; hence, threads don't synchronize while writing, and the
+ * result is the same as with a single thread.
+ *
+ * @param tfidf_vecs tf-idf vector of each sentence, one per row.
+ * @param n_threads Number of threads. If 0, the number of hardware threads is
+ * used.
+ * @return A bit-packed symmetric adjacency matrix.
+ */
+AdjacencyMatrix build_adjacency_matrix(const SparseRows<double>& tfidf_vecs,
+                                       size_t n_threads = 1);
+
+/**
+ * @brief Build the same adjacency matrix as ir::build_adjacency_matrix using
+ * an inverted index of the tf-idf vectors.
+ *
+ * Instead of computing the cosine similarity of all \f$n(n - 1)/2\f$ pairs
+ * of sentences, only the pairs that share terms are considered, and most of
+ * them are pruned before their similarity is computed (see
+ * ir::similarity_join). Hence, the running time is proportional to the
+ * overlap between the sentences rather than the square of their number.
+ *
+ * @param tfidf_vecs tf-idf vector of each sentence, one per row.
+ * @return A bit-packed symmetric adjacency matrix.
  */
-Matrix<char> build_adjacency_matrix(
-    const std::vector<std::unordered_map<std::string, double>>& tfidf_maps);
+AdjacencyMatrix
+build_adjacency_matrix_indexed(const SparseRows<double>& tfidf_vecs);
+
+/**
+ * @brief Build an approximation of the adjacency matrix built by
+ * ir::build_adjacency_matrix using locality-sensitive hashing.
+ *
+ * Every edge of the returned matrix is an edge of the exact matrix, but some
+ * of the exact edges may be missing. The fraction of the found edges is
+ * estimated on a sample of sentences and stored in stats (see
+ * ir::approximate_similarity_join).
+ *
+ * @param tfidf_vecs tf-idf vector of each sentence, one per row.
+ * @param options Sketch and band parameters trading recall for speed.
+ * @param stats If not nullptr, statistics of the approximation are stored
+ * here.
+ * @return A bit-packed symmetric adjacency matrix.
+ */
+AdjacencyMatrix
+build_adjacency_matrix_approximate(const SparseRows<double>& tfidf_vecs,
+                                   const LshOptions& options,
+                                   LshStats* stats = nullptr);
+
+/**
+ * @brief Return the graph method with the given name.
+ *
+ * @param name One of "exhaustive", "indexed" and "lsh".
+ * @return Graph method.
+ *
+ * @throw std::invalid_argument if there is no method with the given name.
+ */
+GraphMethod graph_method_from_name(const std::string& name);
 
 /**
  * @brief Construct the Markov Chain transition probability matrix from the
@@ -89,20 +221,43 @@ Matrix<char> build_adjacency_matrix(
  * @return Transition probability matrix of the underlying Markov Chain
  * constructed with the given damping factor.
  */
-Matrix<double> markov_chain_mat(const Matrix<char>& adj_mat,
+Matrix<double> markov_chain_mat(const AdjacencyMatrix& adj_mat,
                                 double damping_factor);
 
+/**
+ * @brief Construct the sparse Markov Chain transition probability matrix from
+ * the given adjacency matrix and the damping factor.
+ *
+ * The returned matrix represents the same matrix as ir::markov_chain_mat, but
+ * only the edges of the graph are stored and teleportation is applied
+ * implicitly (see ir::TransitionMatrix).
+ *
+ * @param adj_mat Adjacency matrix.
+ * @param damping_factor Damping factor to apply.
+ * @return Sparse transition probability matrix of the underlying Markov Chain
+ * constructed with the given damping factor.
+ */
+TransitionMatrix markov_chain(const AdjacencyMatrix& adj_mat,
+                              double damping_factor);
+
 /**
  * @brief Apply LexRank algorithm to the folliwng normalized document and return
  * the LexRank score of each sentence in the given order.
  *
  * @param norm_doc A normalized document containing terms and counts of each
  * sentence.
- * @param idf_scores A map containing idf scores of all terms that occur in the
- * given document.
+ * @param idf_model Model storing the idf score of each term. Terms of the
+ * given document without a score are treated as options.oov selects.
+ * @param options Graph and solver methods.
+ * @param stats If not nullptr, statistics of the graph and the solver are
+ * stored here.
  * @return Vector of LexRank score of each sentence in the given order.
+ *
+ * @throw std::out_of_range if options.oov is ir::OovPolicy::Error and a term
+ * of the document has no idf score.
  */
-std::vector<double>
-lexrank(const ir::NormalizedDocument& norm_doc,
-        const std::unordered_map<std::string, double>& idf_scores);
+std::vector<double> lexrank(const ir::NormalizedDocument& norm_doc,
+                            const IdfModel& idf_model,
+                            const LexrankOptions& options = LexrankOptions(),
+                            LexrankStats* stats = nullptr);
 } // namespace ir
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
 #include "defs.hpp"
@@ -26,6 +29,27 @@ namespace ir {
  */
 ir::RawDocument parse_doc_file(std::istream& input_stream);
 
+/**
+ * @brief Parse a document stored as a single line JSON object.
+ *
+ * The object must have a "sentences" member, an array of the sentences of
+ * the document as strings, and may have an "id" member, a string or a number
+ * identifying the document. Other members are ignored. For example,
+ *
+ * <blockquote>
+ * {"id": "123", "sentences": ["First sentence.", "Second sentence."]}
+ * </blockquote>
+ *
+ * @param line JSON object.
+ * @param id ID of the document is stored here; empty if there is no "id"
+ * member. A numeric ID is stored as it is written.
+ * @return An ir::RawDocument storing the parsed document.
+ *
+ * @throw std::runtime_error if the line is not a valid JSON object, or it
+ * doesn't have a valid "sentences" member.
+ */
+ir::RawDocument parse_json_doc(std::string_view line, std::string& id);
+
 /**
  * @brief Parse each file in the given filelist and return a map from document
  * IDs to ir::RawDocument objects.
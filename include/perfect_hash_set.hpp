@@ -0,0 +1,225 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ir {
+
+/**
+ * @brief 64-bit FNV-1a hash of the given string.
+ *
+ * @param str String to hash.
+ * @return Hash value.
+ */
+constexpr std::uint64_t fnv1a64(std::string_view str) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const char c : str) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Mix the bits of the given value (splitmix64 finalizer).
+ *
+ * @param x Value to mix.
+ * @return Mixed value.
+ */
+constexpr std::uint64_t mix64(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * @brief Return the smallest power of two not less than the given value.
+ *
+ * @param n Value.
+ * @return Power of two.
+ */
+constexpr size_t next_pow2(size_t n) {
+    size_t result = 1;
+    while (result < n) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * @brief An immutable set of strings that can be built at compile time and
+ * is queried with a perfect hash function.
+ *
+ * The perfect hash function is built with the hash-and-displace method. Every
+ * key is hashed once; the hash selects one of NBuckets buckets, and each
+ * bucket stores a displacement seed chosen during construction so that the
+ * keys of all buckets map to distinct slots. Hence, a lookup is a single
+ * hash of the query, one seed load, one mix and a single string comparison,
+ * and never allocates.
+ *
+ * Keys must be non-empty and distinct, and must outlive the set (string
+ * literals when the set is constexpr). If no seed assignment is found,
+ * built() returns false; constexpr sets should static_assert on it.
+ *
+ * @tparam N Number of keys.
+ * @tparam NSlots Number of slots. Must be a power of two not less than N.
+ * @tparam NBuckets Number of displacement buckets.
+ */
+template <size_t N, size_t NSlots = next_pow2(2 * N),
+          size_t NBuckets = (N + 1) / 2>
+class PerfectHashSet {
+    static_assert(N > 0, "PerfectHashSet must have at least one key");
+    static_assert(NSlots >= N && (NSlots & (NSlots - 1)) == 0,
+                  "Number of slots must be a power of two not less than N");
+
+  public:
+    /**
+     * @brief Build the set of the given keys.
+     *
+     * @param keys Distinct non-empty keys.
+     */
+    constexpr explicit PerfectHashSet(
+        const std::array<std::string_view, N>& keys)
+        : m_slots(), m_seeds(), m_built(false) {
+        // assign keys to buckets
+        std::array<size_t, N> bucket_of{};
+        std::array<size_t, NBuckets> bucket_size{};
+        for (size_t i = 0; i < N; ++i) {
+            bucket_of[i] = bucket(fnv1a64(keys[i]));
+            ++bucket_size[bucket_of[i]];
+        }
+
+        // place the largest buckets first, while most slots are free
+        std::array<size_t, NBuckets> order{};
+        for (size_t b = 0; b < NBuckets; ++b) {
+            order[b] = b;
+        }
+        for (size_t i = 1; i < NBuckets; ++i) {
+            for (size_t j = i; j > 0 && bucket_size[order[j - 1]] <
+                                            bucket_size[order[j]];
+                 --j) {
+                const size_t tmp = order[j];
+                order[j] = order[j - 1];
+                order[j - 1] = tmp;
+            }
+        }
+
+        std::array<bool, NSlots> used{};
+        for (size_t b_index = 0; b_index < NBuckets; ++b_index) {
+            const size_t b = order[b_index];
+            if (bucket_size[b] == 0) {
+                break;
+            }
+
+            // find a seed mapping every key of the bucket to a free slot
+            bool placed = false;
+            for (std::uint64_t seed = 0; seed < MaxSeed && !placed; ++seed) {
+                std::array<size_t, N> bucket_slots{};
+                size_t n_placed = 0;
+                bool ok = true;
+                for (size_t i = 0; i < N && ok; ++i) {
+                    if (bucket_of[i] != b) {
+                        continue;
+                    }
+                    const size_t s = slot(fnv1a64(keys[i]), seed);
+                    ok = !used[s];
+                    for (size_t p = 0; p < n_placed && ok; ++p) {
+                        ok = bucket_slots[p] != s;
+                    }
+                    bucket_slots[n_placed++] = s;
+                }
+                if (!ok) {
+                    continue;
+                }
+
+                n_placed = 0;
+                for (size_t i = 0; i < N; ++i) {
+                    if (bucket_of[i] == b) {
+                        const size_t s = bucket_slots[n_placed++];
+                        used[s] = true;
+                        m_slots[s] = keys[i];
+                    }
+                }
+                m_seeds[b] = seed;
+                placed = true;
+            }
+
+            if (!placed) {
+                return;
+            }
+        }
+
+        m_built = true;
+    }
+
+    /**
+     * @brief Check whether the given string is in the set.
+     *
+     * @param key String to look up.
+     * @return true if key is in the set; false, otherwise.
+     */
+    constexpr bool contains(std::string_view key) const {
+        const std::uint64_t hash = fnv1a64(key);
+        const std::string_view& candidate =
+            m_slots[slot(hash, m_seeds[bucket(hash)])];
+        // empty slots hold empty views, and keys are never empty
+        return !key.empty() && candidate == key;
+    }
+
+    /**
+     * @brief Return whether a perfect hash function was found for the keys.
+     *
+     * @return true if the set is usable; false, otherwise.
+     */
+    constexpr bool built() const { return m_built; }
+
+    /**
+     * @brief Return the number of keys in the set.
+     *
+     * @return Number of keys.
+     */
+    constexpr size_t size() const { return N; }
+
+  private:
+    /**
+     * @brief Number of seeds tried for a bucket before giving up.
+     */
+    static constexpr std::uint64_t MaxSeed = 1 << 16;
+
+    /**
+     * @brief Return the bucket of a key hash.
+     */
+    static constexpr size_t bucket(std::uint64_t hash) {
+        return static_cast<size_t>((hash >> 32) % NBuckets);
+    }
+
+    /**
+     * @brief Return the slot of a key hash displaced with the given seed.
+     */
+    static constexpr size_t slot(std::uint64_t hash, std::uint64_t seed) {
+        const std::uint64_t displaced = hash ^ (seed * 0x9e3779b97f4a7c15ull);
+        return static_cast<size_t>(mix64(displaced) & (NSlots - 1));
+    }
+
+    /**
+     * @brief Key stored at each slot; empty if the slot is unused.
+     */
+    std::array<std::string_view, NSlots> m_slots;
+
+    /**
+     * @brief Displacement seed of each bucket.
+     */
+    std::array<std::uint64_t, NBuckets> m_seeds;
+
+    /**
+     * @brief Whether a perfect hash function was found.
+     */
+    bool m_built;
+};
+
+} // namespace ir
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace ir {
+
+/**
+ * @brief Stem the given lowercase word using the Porter Stemmer and return the
+ * length of the stem.
+ *
+ * The stem is written to out and is never longer than the word. Since Porter
+ * Stemmer replaces some suffixes, the stem is not necessarily a prefix of the
+ * word; out must point to a buffer of at least word.size() characters, and
+ * may point to word.data() to stem the word in-place.
+ *
+ * The stemmer keeps its state in a context local to each call, so this
+ * function can be called from multiple threads concurrently.
+ *
+ * @param word Lowercase word to stem.
+ * @param out Buffer to write the stem to.
+ * @return Number of characters of the stem written to out.
+ */
+size_t stem(std::string_view word, char* out);
+
+} // namespace ir
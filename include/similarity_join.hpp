@@ -0,0 +1,206 @@
+#pragma once
+
+#include "adjacency_matrix.hpp"
+#include "sparse.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace ir {
+
+/**
+ * @brief Default number of LSH bands of ir::approximate_similarity_join.
+ */
+const size_t DefaultLshBands = 16;
+
+/**
+ * @brief Default number of sketch bits in each LSH band.
+ */
+const size_t DefaultLshRows = 8;
+
+/**
+ * @brief Default largest LSH bucket that isn't split by further bands.
+ */
+const size_t DefaultLshMaxBucket = 32;
+
+/**
+ * @brief Default number of rows whose exact neighbors are computed to
+ * estimate the recall of ir::approximate_similarity_join.
+ */
+const size_t DefaultRecallSample = 32;
+
+/**
+ * @brief Probability, at the similarity threshold, of becoming a candidate
+ * pair below which the approximate join is reported to drop most edges (see
+ * ir::lsh_candidate_probability).
+ */
+const double LshMinCandidateProbability = 0.9;
+
+/**
+ * @brief Parameters of ir::approximate_similarity_join.
+ *
+ * Two vectors at angle \f$\theta\f$ agree on a sketch bit with probability
+ * \f$p = 1 - \theta / \pi\f$, and become a candidate pair with probability
+ * \f$1 - (1 - p^r)^b\f$ where \f$b\f$ is the number of bands and \f$r\f$ is
+ * the number of rows. More bands increase recall; more rows decrease the
+ * number of candidates, and hence the running time, and the recall.
+ *
+ * Unrelated sentences are nearly orthogonal (\f$p \approx 1/2\f$), and a
+ * pair at the LexRank threshold 0.1 has \f$p \approx 0.53\f$, so no choice
+ * of parameters finds most edges at that threshold without making most
+ * pairs candidates. The defaults bound the running time instead: with at
+ * most max_bucket rows per bucket, each row has at most
+ * \f$b \cdot max\_bucket\f$ candidates. ir::similarity_join is exact and,
+ * at the LexRank threshold, usually faster; this join is useful when the
+ * inverted index finds too many candidates, e.g. for long sentences sharing
+ * frequent terms, and its recall should be checked (see ir::LshStats). With
+ * the defaults, a pair at the LexRank threshold is a candidate with
+ * probability of about 0.1; reaching ir::LshMinCandidateProbability takes
+ * about 360 bands of 8 rows, or 4 bands of a single row.
+ */
+struct LshOptions {
+    /**
+     * @brief Number of bands.
+     */
+    size_t bands = DefaultLshBands;
+
+    /**
+     * @brief Number of sketch bits in each band. Must be between 1 and 64.
+     */
+    size_t rows = DefaultLshRows;
+
+    /**
+     * @brief Largest bucket of a band whose rows are all candidates of each
+     * other. Larger buckets are split by the keys of the following bands.
+     */
+    size_t max_bucket = DefaultLshMaxBucket;
+
+    /**
+     * @brief Seed of the random hyperplanes.
+     */
+    std::uint64_t seed = 0;
+
+    /**
+     * @brief Number of rows sampled to estimate the recall. 0 disables the
+     * estimation.
+     */
+    size_t recall_sample = DefaultRecallSample;
+};
+
+/**
+ * @brief Statistics of ir::approximate_similarity_join.
+ */
+struct LshStats {
+    /**
+     * @brief Number of distinct candidate pairs verified with
+     * ir::cosine_sim.
+     */
+    size_t candidates = 0;
+
+    /**
+     * @brief Number of pairs found whose similarity reaches the threshold.
+     */
+    size_t edges = 0;
+
+    /**
+     * @brief Number of pairs of the sampled rows whose similarity reaches the
+     * threshold.
+     */
+    size_t sample_edges = 0;
+
+    /**
+     * @brief Number of the sample_edges pairs that were found.
+     */
+    size_t sample_found = 0;
+
+    /**
+     * @brief Estimated fraction of the pairs whose similarity reaches the
+     * threshold that were found; 1 if the sample has no such pairs.
+     */
+    double recall = 1;
+};
+
+/**
+ * @brief Find all pairs of unit length sparse vectors whose dot product is
+ * greater than or equal to the given threshold using an inverted index.
+ *
+ * This is the All-Pairs similarity join. Vectors are processed one at a
+ * time, and each vector is first probed against an inverted index of the
+ * previously processed vectors, and then added to the index. Probing
+ * accumulates partial dot products only for the vectors that share a term
+ * with the probing vector, so pairs with no common terms are never
+ * examined. Two filters keep the index and the candidate set small:
+ *
+ * 1. Prefix filtering: terms of each vector are visited from the most to the
+ * least frequent in the given rows, and a term is indexed only after the
+ * upper bound \f$\sum_{w} x_w \cdot \max_y y_w\f$ of the visited terms
+ * reaches the threshold. A vector can't reach the threshold through its
+ * unindexed prefix alone, so the frequent terms mostly stay out of the index
+ * and their long posting lists are never scanned.
+ * 2. Length filtering: since all vectors are unit length,
+ * \f$x \cdot y \le \max_w x_w \sqrt{|y|}\f$ where \f$|y|\f$ is the number of
+ * entries of \f$y\f$. Hence, vectors with fewer than
+ * \f$(t / \max_w x_w)^2\f$ entries are skipped while probing with \f$x\f$.
+ *
+ * Candidates whose accumulated dot product plus the bound of their unindexed
+ * prefix reaches the threshold are verified with ir::cosine_sim. Therefore,
+ * the result is exactly the same as comparing every pair with ir::cosine_sim.
+ *
+ * @param vecs Unit length sparse vectors, one per row (see
+ * ir::tf_idf_vectors).
+ * @param threshold Similarity threshold. Must be positive.
+ * @return Adjacency matrix with an edge between every pair of different rows
+ * whose similarity is at least threshold. Rows are not connected to
+ * themselves.
+ */
+AdjacencyMatrix similarity_join(const SparseRows<double>& vecs,
+                                double threshold);
+
+/**
+ * @brief Find the pairs of unit length sparse vectors whose dot product is
+ * greater than or equal to the given threshold approximately, using
+ * locality-sensitive hashing.
+ *
+ * Each vector is sketched by the signs of its projections onto
+ * \f$b \cdot r\f$ random Gaussian hyperplanes (SimHash), and the sketch is
+ * split into \f$b\f$ bands of \f$r\f$ bits. Vectors with an identical band
+ * are candidate pairs, and only the candidates are verified with
+ * ir::cosine_sim. Hence, every returned edge is exact, but some pairs whose
+ * similarity reaches the threshold may be missed (see ir::LshOptions).
+ *
+ * Buckets larger than options.max_bucket are split by the keys of the
+ * following bands, and each candidate pair is verified once, however many
+ * bands it shares. Hence, the number of verified pairs grows linearly with
+ * the number of vectors unless many vectors have the same sketch.
+ *
+ * To estimate the recall, the exact neighbors of options.recall_sample
+ * evenly spaced rows are computed and compared with the returned edges.
+ *
+ * @param vecs Unit length sparse vectors, one per row (see
+ * ir::tf_idf_vectors).
+ * @param threshold Similarity threshold. Must be positive.
+ * @param options Sketch and band parameters.
+ * @param stats If not nullptr, statistics of the join are stored here.
+ * @return Adjacency matrix with an edge between the found pairs of different
+ * rows. Rows are not connected to themselves.
+ */
+AdjacencyMatrix approximate_similarity_join(const SparseRows<double>& vecs,
+                                            double threshold,
+                                            const LshOptions& options,
+                                            LshStats* stats = nullptr);
+
+/**
+ * @brief Return the probability that two vectors with the given cosine
+ * similarity become a candidate pair of ir::approximate_similarity_join,
+ * \f$1 - (1 - p^r)^b\f$ (see ir::LshOptions).
+ *
+ * Splitting large buckets only removes candidates, so this is an upper bound
+ * of the expected recall of pairs at that similarity.
+ *
+ * @param options Sketch and band parameters.
+ * @param similarity Cosine similarity of the pair.
+ * @return Candidate probability.
+ */
+double lsh_candidate_probability(const LshOptions& options,
+                                 double similarity);
+
+} // namespace ir
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "matrix.hpp"
+#include "transition_matrix.hpp"
+#include <cstddef>
+#include <string>
+
+namespace ir {
+
+/**
+ * @brief Epsilon value that determines the convergence of power iteration.
+ *
+ * During power iteration, for vectors \f$x^t\f$ and \f$x^{t+1}\f$ where \f$t\f$
+ * is iteration count, if
+ *
+ * \f[
+ *     |x_i^t - x_i^{t+1}| \leq \epsilon \qquad \forall i
+ * \f]
+ *
+ * then it is assumed that power iteration has converged.
+ */
+const double PowerIterationEpsilon = 1e-5;
+
+/**
+ * @brief Default maximum number of iterations of an iterative solver.
+ */
+const size_t DefaultMaxIterations = 1000;
+
+/**
+ * @brief Vector norm used to measure the difference between consecutive
+ * iterates.
+ */
+enum class ResidualNorm {
+    /**
+     * @brief Sum of absolute differences.
+     */
+    L1,
+
+    /**
+     * @brief Maximum absolute difference.
+     */
+    LInf
+};
+
+/**
+ * @brief Number of states up to which ir::SolverMethod::Auto solves the
+ * stationary distribution directly with ir::SolverMethod::DenseLU.
+ */
+const size_t DenseSolverMaxSize = 128;
+
+/**
+ * @brief Graph density (fraction of nonzero link probabilities) above which
+ * ir::SolverMethod::Auto prefers extrapolated power iteration to Gauss-Seidel.
+ */
+const double DenseGraphDensity = 0.5;
+
+/**
+ * @brief Number of power iterations between two Aitken extrapolations.
+ */
+const size_t AitkenPeriod = 10;
+
+/**
+ * @brief Method used to find the stationary distribution of a Markov Chain.
+ */
+enum class SolverMethod {
+    /**
+     * @brief Power iteration (see ir::power_iteration).
+     */
+    Power,
+
+    /**
+     * @brief Gauss-Seidel iteration with successive over-relaxation (see
+     * ir::gauss_seidel).
+     */
+    GaussSeidel,
+
+    /**
+     * @brief Power iteration with periodic Aitken extrapolation (see
+     * ir::aitken_power_iteration).
+     */
+    Aitken,
+
+    /**
+     * @brief Direct solution with dense LU decomposition (see ir::dense_lu).
+     */
+    DenseLU,
+
+    /**
+     * @brief Choose one of the methods with respect to the number of states
+     * and the graph density (see ir::choose_solver).
+     */
+    Auto
+};
+
+/**
+ * @brief Convergence criteria of an iterative solver.
+ */
+struct SolverOptions {
+    /**
+     * @brief Method used by ir::solve.
+     */
+    SolverMethod method = SolverMethod::Power;
+
+    /**
+     * @brief Relaxation factor \f$\omega \in (0, 2)\f$ of Gauss-Seidel
+     * iteration. 1 is plain Gauss-Seidel; larger values over-relax.
+     */
+    double relaxation = 1.0;
+
+    /**
+     * @brief The solver has converged when the residual is less than or equal
+     * to this value.
+     */
+    double tolerance = PowerIterationEpsilon;
+
+    /**
+     * @brief Maximum number of iterations; the solver stops even if it hasn't
+     * converged.
+     */
+    size_t max_iterations = DefaultMaxIterations;
+
+    /**
+     * @brief Norm used to compute the residual.
+     */
+    ResidualNorm norm = ResidualNorm::LInf;
+};
+
+/**
+ * @brief Statistics of a solver run.
+ */
+struct SolverStats {
+    /**
+     * @brief Method that computed the distribution.
+     */
+    SolverMethod method = SolverMethod::Power;
+
+    /**
+     * @brief Number of iterations done.
+     */
+    size_t iterations = 0;
+
+    /**
+     * @brief Norm of the difference between the last two iterates.
+     */
+    double residual = 0;
+
+    /**
+     * @brief Whether the residual reached the tolerance before the maximum
+     * number of iterations.
+     */
+    bool converged = false;
+};
+
+/**
+ * @brief Return the given norm of \f$x - y\f$.
+ *
+ * @param x First vector.
+ * @param y Second vector of the same size.
+ * @param norm Norm to use.
+ * @return Norm of the difference.
+ */
+double residual(const Vector<double>& x, const Vector<double>& y,
+                ResidualNorm norm);
+
+/**
+ * @brief Find the stationary distribution of the given Markov Chain using
+ * power iteration.
+ *
+ * The iteration \f$x^{t+1} = Tx^t\f$ is computed in-place on dist and the
+ * given scratch vector, which are swapped after every step. Hence, no memory
+ * is allocated.
+ *
+ * @param trans_mat Transition matrix of the Markov Chain.
+ * @param dist Initial distribution of size trans_mat.size(). Stores the last
+ * iterate when the function returns.
+ * @param scratch Vector of size trans_mat.size() used as the second buffer.
+ * Its contents are overwritten.
+ * @param options Convergence criteria.
+ * @return Number of iterations, final residual and whether the iteration
+ * converged.
+ */
+SolverStats power_iteration(const TransitionMatrix& trans_mat,
+                            Vector<double>& dist, Vector<double>& scratch,
+                            const SolverOptions& options = SolverOptions());
+
+/**
+ * @brief Find the stationary distribution of the given Markov Chain using
+ * Gauss-Seidel iteration with successive over-relaxation.
+ *
+ * The stationary distribution \f$x\f$ with \f$\sum_i x_i = s\f$ solves
+ * the linear system
+ *
+ * \f[
+ *     (I - (1 - d)P)x = \frac{d s}{N}\boldsymbol{1}
+ * \f]
+ *
+ * (see ir::TransitionMatrix). Each step updates the states in order using the
+ * already updated values of the previous states, which typically converges
+ * in a fraction of the iterations of power iteration at the same cost per
+ * iteration. The iteration is done in-place; the residual is the norm of the
+ * difference between consecutive iterates as in power iteration.
+ *
+ * @param trans_mat Transition matrix of the Markov Chain.
+ * @param dist Initial distribution of size trans_mat.size(); its sum \f$s\f$
+ * is preserved. Stores the last iterate when the function returns.
+ * @param options Convergence criteria and relaxation factor.
+ * @return Number of iterations, final residual and whether the iteration
+ * converged.
+ */
+SolverStats gauss_seidel(const TransitionMatrix& trans_mat,
+                         Vector<double>& dist,
+                         const SolverOptions& options = SolverOptions());
+
+/**
+ * @brief Find the stationary distribution of the given Markov Chain using
+ * power iteration accelerated with Aitken extrapolation.
+ *
+ * Every ir::AitkenPeriod iterations, the last three iterates
+ * \f$x^{t-2}, x^{t-1}, x^t\f$ are extrapolated componentwise as
+ *
+ * \f[
+ *     x_i \leftarrow x_i^t -
+ *         \frac{(x_i^t - x_i^{t-1})^2}{x_i^t - 2x_i^{t-1} + x_i^{t-2}}
+ * \f]
+ *
+ * which removes the error component of the second largest eigenvalue, and
+ * the result is rescaled to the original sum. A third buffer is allocated
+ * once per call.
+ *
+ * @param trans_mat Transition matrix of the Markov Chain.
+ * @param dist Initial distribution of size trans_mat.size(). Stores the last
+ * iterate when the function returns.
+ * @param scratch Vector of size trans_mat.size() used as the second buffer.
+ * @param options Convergence criteria.
+ * @return Number of iterations, final residual and whether the iteration
+ * converged.
+ */
+SolverStats aitken_power_iteration(
+    const TransitionMatrix& trans_mat, Vector<double>& dist,
+    Vector<double>& scratch, const SolverOptions& options = SolverOptions());
+
+/**
+ * @brief Find the stationary distribution of the given Markov Chain by
+ * solving the linear system of ir::gauss_seidel directly with dense LU
+ * decomposition with partial pivoting.
+ *
+ * This takes \f$O(N^3)\f$ time and \f$O(N^2)\f$ memory; hence, it is only
+ * suitable for small chains. The reported residual is the norm of
+ * \f$Tx - x\f$.
+ *
+ * @param trans_mat Transition matrix of the Markov Chain.
+ * @param dist Initial distribution of size trans_mat.size(); only its sum is
+ * used. Stores the solution when the function returns.
+ * @param scratch Vector of size trans_mat.size() used to compute the
+ * residual.
+ * @param options Norm of the residual.
+ * @return One iteration, the residual and whether it is within tolerance.
+ */
+SolverStats dense_lu(const TransitionMatrix& trans_mat, Vector<double>& dist,
+                     Vector<double>& scratch,
+                     const SolverOptions& options = SolverOptions());
+
+/**
+ * @brief Choose a method to find the stationary distribution of the given
+ * Markov Chain.
+ *
+ * Chains with at most ir::DenseSolverMaxSize states are solved directly with
+ * ir::SolverMethod::DenseLU. Larger chains are solved with
+ * ir::SolverMethod::GaussSeidel, unless their graph density is above
+ * ir::DenseGraphDensity, in which case ir::SolverMethod::Aitken is used.
+ *
+ * @param trans_mat Transition matrix of the Markov Chain.
+ * @return Chosen method; never ir::SolverMethod::Auto.
+ */
+SolverMethod choose_solver(const TransitionMatrix& trans_mat);
+
+/**
+ * @brief Find the stationary distribution of the given Markov Chain using the
+ * method in the given options.
+ *
+ * @param trans_mat Transition matrix of the Markov Chain.
+ * @param dist Initial distribution of size trans_mat.size(). Stores the
+ * stationary distribution when the function returns.
+ * @param scratch Vector of size trans_mat.size() used as a second buffer.
+ * @param options Method and convergence criteria.
+ * @return Statistics of the chosen solver.
+ */
+SolverStats solve(const TransitionMatrix& trans_mat, Vector<double>& dist,
+                  Vector<double>& scratch,
+                  const SolverOptions& options = SolverOptions());
+
+/**
+ * @brief Parse the name of a solver method.
+ *
+ * @param name One of "power", "gauss-seidel", "aitken", "lu" and "auto".
+ * @return Parsed method.
+ * @throw std::invalid_argument if the name is unknown.
+ */
+SolverMethod solver_method_from_name(const std::string& name);
+
+} // namespace ir
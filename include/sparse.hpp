@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Dense integer ID of a normalized term in an ir::Vocabulary.
+ */
+using term_id = std::uint32_t;
+
+/**
+ * @brief Term ID value that doesn't correspond to any term.
+ */
+const term_id InvalidTermID = std::numeric_limits<term_id>::max();
+
+/**
+ * @brief A read-only view of a single sparse row stored in an
+ * ir::SparseRows object.
+ *
+ * The entries of a row are (term ID, value) pairs sorted by term ID in
+ * strictly increasing order.
+ *
+ * @tparam T Type of the values stored in the row.
+ */
+template <typename T> class SparseRow {
+  public:
+    /**
+     * @brief Type of the values stored in this row type.
+     */
+    using value_type = T;
+
+    /**
+     * @brief Construct a view of size many entries starting at the given
+     * term and value pointers.
+     *
+     * @param terms Pointer to the first term ID of the row.
+     * @param values Pointer to the first value of the row.
+     * @param size Number of entries.
+     */
+    SparseRow(const term_id* terms, const T* values, size_t size)
+        : m_terms(terms), m_values(values), m_size(size) {}
+
+    /**
+     * @brief Return the term ID of the ith entry.
+     *
+     * @param i Index of the entry.
+     * @return Term ID of the ith entry.
+     */
+    term_id term(size_t i) const { return m_terms[i]; }
+
+    /**
+     * @brief Return a const-reference to the value of the ith entry.
+     *
+     * @param i Index of the entry.
+     * @return const-reference to the value of the ith entry.
+     */
+    const T& value(size_t i) const { return m_values[i]; }
+
+    /**
+     * @brief Return pointer to the beginning of the sorted term ID sequence.
+     *
+     * @return const pointer to the first term ID.
+     */
+    const term_id* terms() const { return m_terms; }
+
+    /**
+     * @brief Return pointer to the beginning of the value sequence.
+     *
+     * @return const pointer to the first value.
+     */
+    const T* values() const { return m_values; }
+
+    /**
+     * @brief Return the number of entries of this row.
+     *
+     * @return Number of entries.
+     */
+    size_t size() const { return m_size; }
+
+    /**
+     * @brief Check whether this row has no entries.
+     *
+     * @return true if the row is empty; false, otherwise.
+     */
+    bool empty() const { return m_size == 0; }
+
+  private:
+    /**
+     * @brief Pointer to the first term ID.
+     */
+    const term_id* m_terms;
+
+    /**
+     * @brief Pointer to the first value.
+     */
+    const T* m_values;
+
+    /**
+     * @brief Number of entries.
+     */
+    size_t m_size;
+};
+
+/**
+ * @brief A sequence of sparse rows stored contiguously in compressed sparse
+ * row (CSR) format.
+ *
+ * Term IDs and values of all rows are stored in two contiguous arrays, and
+ * the entries of row \f$i\f$ are in the half-open range
+ * \f$[offset_i, offset_{i+1})\f$ of these arrays. Within a row, entries are
+ * sorted by term ID. Hence, a whole document needs a handful of allocations
+ * regardless of its number of sentences.
+ *
+ * Rows are built by appending entries to the last row using push_back and
+ * then closing it using end_row.
+ *
+ * @tparam T Type of the values stored.
+ */
+template <typename T> class SparseRows {
+  public:
+    /**
+     * @brief Type of the values stored by this SparseRows type.
+     */
+    using value_type = T;
+
+    /**
+     * @brief Default constructor constructing an object with no rows.
+     */
+    SparseRows() : m_offsets(1, 0) {}
+
+    /**
+     * @brief Reserve memory for the given number of rows and entries.
+     *
+     * @param rows Number of rows.
+     * @param entries Total number of entries of all rows.
+     */
+    void reserve(size_t rows, size_t entries) {
+        m_offsets.reserve(rows + 1);
+        m_terms.reserve(entries);
+        m_values.reserve(entries);
+    }
+
+    /**
+     * @brief Append an entry to the row currently being built.
+     *
+     * Entries of a row must be appended in strictly increasing term ID order.
+     *
+     * @param term Term ID of the entry.
+     * @param value Value of the entry.
+     */
+    void push_back(term_id term, const T& value) {
+        assert((m_terms.size() == m_offsets.back() || m_terms.back() < term) &&
+               "Entries must be appended in increasing term order");
+        m_terms.push_back(term);
+        m_values.push_back(value);
+    }
+
+    /**
+     * @brief Close the row currently being built.
+     *
+     * The entries appended after the previous call to end_row make up the new
+     * row. A row with no entries is valid.
+     */
+    void end_row() { m_offsets.push_back(m_terms.size()); }
+
+    /**
+     * @brief Return a view of the ith row.
+     *
+     * @param i Index of the row.
+     * @return ir::SparseRow view of the ith row.
+     */
+    SparseRow<T> row(size_t i) const {
+        const size_t begin = m_offsets[i];
+        return SparseRow<T>(m_terms.data() + begin, m_values.data() + begin,
+                            m_offsets[i + 1] - begin);
+    }
+
+    /**
+     * @brief Return the number of rows.
+     *
+     * @return Number of rows.
+     */
+    size_t rows() const { return m_offsets.size() - 1; }
+
+    /**
+     * @brief Return the total number of entries of all rows.
+     *
+     * @return Number of entries.
+     */
+    size_t entries() const { return m_terms.size(); }
+
+    /**
+     * @brief Return the term ID sequence of all rows.
+     *
+     * @return const-reference to the term ID sequence.
+     */
+    const std::vector<term_id>& terms() const { return m_terms; }
+
+    /**
+     * @brief Return the value sequence of all rows.
+     *
+     * @return const-reference to the value sequence.
+     */
+    const std::vector<T>& values() const { return m_values; }
+
+    /**
+     * @brief Return the row offsets.
+     *
+     * The returned sequence has rows() + 1 elements.
+     *
+     * @return const-reference to the offset sequence.
+     */
+    const std::vector<size_t>& offsets() const { return m_offsets; }
+
+  private:
+    /**
+     * @brief Start offset of each row followed by the total number of entries.
+     */
+    std::vector<size_t> m_offsets;
+
+    /**
+     * @brief Term IDs of all rows.
+     */
+    std::vector<term_id> m_terms;
+
+    /**
+     * @brief Values of all rows.
+     */
+    std::vector<T> m_values;
+};
+
+} // namespace ir
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "perfect_hash_set.hpp"
+#include <array>
+#include <string_view>
+
+namespace ir {
+
+/**
+ * @brief Number of default stopwords.
+ */
+const size_t DefaultStopwordCount = 54;
+
+/**
+ * @brief Default stopword list compiled into the binary. It is the same list
+ * as stopwords.txt at the root of the repository.
+ */
+constexpr std::array<std::string_view, DefaultStopwordCount> DefaultStopwords{{
+    "a", "all", "an", "and", "any", "are", "as", "be", "been", "but", "by",
+    "few", "for", "have", "he", "her", "here", "him", "his", "how", "i", "in",
+    "is", "it", "its", "many", "me", "my", "none", "of", "on", "or", "our",
+    "she", "some", "the", "their", "them", "there", "they", "that", "this",
+    "us", "was", "what", "when", "where", "which", "who", "why", "will",
+    "with", "you", "your"}};
+
+/**
+ * @brief Perfect hash set of the default stopwords built at compile time.
+ */
+constexpr PerfectHashSet<DefaultStopwordCount> DefaultStopwordSet(
+    DefaultStopwords);
+
+static_assert(DefaultStopwordSet.built(),
+              "No perfect hash function found for the default stopwords");
+
+} // namespace ir
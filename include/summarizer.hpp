@@ -0,0 +1,158 @@
+#pragma once
+
+#include "defs.hpp"
+#include "idf_model.hpp"
+#include "lexrank.hpp"
+#include "term_cache.hpp"
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Default number of sentences in a summary.
+ */
+const size_t SummarySentenceCount = 3;
+
+/**
+ * @brief LexRank scores of a document and the sentences chosen as its
+ * summary.
+ */
+struct Summary {
+    /**
+     * @brief LexRank score of each sentence in the document order.
+     */
+    std::vector<double> scores;
+
+    /**
+     * @brief Indices of the summary sentences in decreasing LexRank score
+     * order. Sentences with equal scores are ordered by their index.
+     */
+    std::vector<size_t> top_sentences;
+
+    /**
+     * @brief Statistics of the graph and the solver computing the LexRank
+     * scores.
+     */
+    LexrankStats stats;
+};
+
+/**
+ * @brief Normalize the given raw document, compute its LexRank scores and
+ * choose the top_k sentences with the highest scores as its summary.
+ *
+ * The given idf model is only read; hence, this function can be called from
+ * multiple threads concurrently with the same model.
+ *
+ * @param raw_doc Document to summarize.
+ * @param idf_model Model storing the vocabulary and idf scores of the corpus.
+ * @param top_k Number of summary sentences. If the document has fewer
+ * sentences, all of them are chosen.
+ * @param options Graph and solver methods computing the LexRank scores.
+ * @return LexRank scores and summary sentences of the document.
+ *
+ * @throw std::out_of_range if options.oov is ir::OovPolicy::Error and a term
+ * of the document has no idf score.
+ */
+Summary summarize(const RawDocument& raw_doc, const IdfModel& idf_model,
+                  size_t top_k = SummarySentenceCount,
+                  const LexrankOptions& options = LexrankOptions());
+
+/**
+ * @brief Summarize the given raw document like the overload above, looking
+ * its tokens up in the given cache instead of a cache of the calling thread.
+ *
+ * @param raw_doc Document to summarize.
+ * @param idf_model Model storing the vocabulary and idf scores of the corpus.
+ * @param top_k Number of summary sentences.
+ * @param options Graph and solver methods computing the LexRank scores.
+ * @param cache Cache of normalized tokens, only used with vocabularies
+ * layered over idf_model.
+ * @return LexRank scores and summary sentences of the document.
+ *
+ * @throw std::out_of_range if options.oov is ir::OovPolicy::Error and a term
+ * of the document has no idf score.
+ */
+Summary summarize(const RawDocument& raw_doc, const IdfModel& idf_model,
+                  size_t top_k, const LexrankOptions& options,
+                  TermCache& cache);
+
+/**
+ * @brief Compute the LexRank scores of the given normalized document and
+ * choose the top_k sentences with the highest scores as its summary.
+ *
+ * This is used for documents that are already normalized, e.g. read from an
+ * ir::DocumentCache.
+ *
+ * @param norm_doc Document normalized with a vocabulary layered over
+ * idf_model (see ir::Vocabulary).
+ * @param idf_model Model storing the vocabulary and idf scores of the corpus.
+ * @param top_k Number of summary sentences. If the document has fewer
+ * sentences, all of them are chosen.
+ * @param options Graph and solver methods computing the LexRank scores.
+ * @return LexRank scores and summary sentences of the document.
+ *
+ * @throw std::out_of_range if options.oov is ir::OovPolicy::Error and a term
+ * of the document has no idf score.
+ */
+Summary summarize(const NormalizedDocument& norm_doc,
+                  const IdfModel& idf_model,
+                  size_t top_k = SummarySentenceCount,
+                  const LexrankOptions& options = LexrankOptions());
+
+/**
+ * @brief Write the LexRank scores and the summary sentences to the given
+ * output stream.
+ *
+ * Each score is written on a separate line with 6 decimal digits, followed by
+ * an empty line and then the summary sentences, each on a separate line.
+ *
+ * @param os Output stream to write the summary.
+ * @param summary Scores and summary sentences to write.
+ * @param raw_doc Raw document containing the original sentences.
+ * @return Modified output stream.
+ */
+std::ostream& write_summary(std::ostream& os, const Summary& summary,
+                            const RawDocument& raw_doc);
+
+/**
+ * @brief Write the given string as a quoted and escaped JSON string.
+ *
+ * @param os Output stream to write the string.
+ * @param str UTF-8 string to write.
+ * @return Modified output stream.
+ */
+std::ostream& write_json_string(std::ostream& os, std::string_view str);
+
+/**
+ * @brief Write the LexRank scores and the summary sentences to the given
+ * output stream as a single line JSON object.
+ *
+ * The object has the members "id", "scores" (LexRank score of each sentence
+ * with 6 decimal digits), "summary" (indices of the summary sentences) and
+ * "sentences" (the summary sentences), and is followed by a newline.
+ *
+ * @param os Output stream to write the summary.
+ * @param id ID of the document.
+ * @param summary Scores and summary sentences to write.
+ * @param raw_doc Raw document containing the original sentences.
+ * @return Modified output stream.
+ */
+std::ostream& write_summary_json(std::ostream& os, std::string_view id,
+                                 const Summary& summary,
+                                 const RawDocument& raw_doc);
+
+/**
+ * @brief Write an error of summarizing a document to the given output stream
+ * as a single line JSON object with the members "id" and "error".
+ *
+ * @param os Output stream to write the error.
+ * @param id ID of the document; may be empty.
+ * @param message Description of the error.
+ * @return Modified output stream.
+ */
+std::ostream& write_error_json(std::ostream& os, std::string_view id,
+                               std::string_view message);
+
+} // namespace ir
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "defs.hpp"
+#include "vocabulary.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief Default number of slots of an ir::TermCache.
+ */
+const size_t DefaultTermCacheSize = 1 << 14;
+
+/**
+ * @brief A bounded memo cache from raw tokens to the IDs of their normalized
+ * terms.
+ *
+ * Natural language text repeats the same surface forms constantly, so most
+ * tokens of a corpus have been normalized (see ir::normalize) before. The
+ * cache remembers the term ID each token was normalized and interned to, or
+ * that the token was normalized to nothing (stopwords and punctuation).
+ *
+ * The cache is direct-mapped: each token hashes to exactly one slot and a
+ * miss replaces the token stored there. Hence, its memory is fixed and
+ * lookups are a single hash and string comparison.
+ *
+ * Term IDs are only meaningful within one ID space (see
+ * Vocabulary::id_space). The cache remembers the ID space of its IDs and
+ * clears itself when it is used with a vocabulary of another one, even if
+ * that vocabulary reuses the address of a destroyed one. Vocabularies layered
+ * on the same ir::IdfModel share the model's IDs; a cache used with them
+ * caches only the terms of the model and can be shared across such
+ * vocabularies. A cache is not thread-safe; use one cache per thread.
+ */
+class TermCache {
+  public:
+    /**
+     * @brief Construct an empty cache.
+     *
+     * @param n_slots Number of slots. Rounded up to a power of two.
+     */
+    explicit TermCache(size_t n_slots = DefaultTermCacheSize);
+
+    /**
+     * @brief Return the ID of the normalized version of the given token,
+     * normalizing it and interning the result to vocab on a miss.
+     *
+     * @param token Raw token.
+     * @param vocab Vocabulary used to map normalized terms to their IDs.
+     * @return ID of the normalized term; ir::InvalidTermID if the token
+     * normalizes to an empty string.
+     */
+    term_id lookup(std::string_view token, Vocabulary& vocab);
+
+    /**
+     * @brief Remove all tokens from the cache. Counters are not reset.
+     */
+    void clear();
+
+    /**
+     * @brief Return the number of lookups answered from the cache.
+     *
+     * @return Number of hits.
+     */
+    size_t hits() const { return m_hits; }
+
+    /**
+     * @brief Return the number of lookups that required normalization.
+     *
+     * @return Number of misses.
+     */
+    size_t misses() const { return m_misses; }
+
+  private:
+    /**
+     * @brief A cached token and the ID of its normalized term.
+     */
+    struct Slot {
+        std::string token;
+        term_id id = InvalidTermID;
+        bool used = false;
+    };
+
+    /**
+     * @brief Cache slots; size is a power of two.
+     */
+    std::vector<Slot> m_slots;
+
+    /**
+     * @brief Generation of the ID space of the cached IDs (see
+     * Vocabulary::id_space); 0 if nothing is cached yet.
+     */
+    std::uint64_t m_id_space = 0;
+
+    /**
+     * @brief Normalized term of the last missed token; reused for every miss.
+     */
+    std::string m_term;
+
+    /**
+     * @brief Lookup counters.
+     */
+    size_t m_hits = 0, m_misses = 0;
+};
+
+/**
+ * @brief Sums of the lookup counters of ir::TermCache objects, e.g. of the
+ * caches of several threads.
+ */
+struct TermCacheStats {
+    /**
+     * @brief Number of lookups answered from a cache.
+     */
+    size_t hits = 0;
+
+    /**
+     * @brief Number of lookups that required normalization.
+     */
+    size_t misses = 0;
+
+    /**
+     * @brief Add the counters of the given cache.
+     *
+     * @param cache Cache whose counters are added.
+     */
+    void add(const TermCache& cache) {
+        hits += cache.hits();
+        misses += cache.misses();
+    }
+
+    /**
+     * @brief Add the given sums of counters.
+     *
+     * @param other Sums to add.
+     */
+    void add(const TermCacheStats& other) {
+        hits += other.hits;
+        misses += other.misses;
+    }
+};
+
+} // namespace ir
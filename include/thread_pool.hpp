@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ir {
+
+/**
+ * @brief A fixed-size pool of worker threads executing submitted tasks in
+ * FIFO order.
+ */
+class ThreadPool {
+  public:
+    /**
+     * @brief Type of the tasks executed by the pool.
+     */
+    using task = std::function<void()>;
+
+    /**
+     * @brief Start the given number of worker threads.
+     *
+     * @param n_threads Number of worker threads. If 0, the number of hardware
+     * threads is used.
+     */
+    explicit ThreadPool(size_t n_threads);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Wait for all submitted tasks to finish and join the workers.
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Submit a task to be executed by one of the workers.
+     *
+     * @param t Task to execute. It must not throw.
+     */
+    void submit(task t);
+
+    /**
+     * @brief Block until every submitted task has finished.
+     */
+    void wait();
+
+    /**
+     * @brief Return the number of worker threads.
+     *
+     * @return Number of worker threads.
+     */
+    size_t size() const { return m_workers.size(); }
+
+  private:
+    /**
+     * @brief Main loop of each worker thread.
+     */
+    void work();
+
+    /**
+     * @brief Worker threads.
+     */
+    std::vector<std::thread> m_workers;
+
+    /**
+     * @brief Tasks waiting to be executed.
+     */
+    std::deque<task> m_tasks;
+
+    /**
+     * @brief Number of submitted tasks that haven't finished yet.
+     */
+    size_t m_pending = 0;
+
+    /**
+     * @brief Whether the workers should exit once the queue is empty.
+     */
+    bool m_stop = false;
+
+    /**
+     * @brief Mutex guarding the queue and the counters.
+     */
+    std::mutex m_mutex;
+
+    /**
+     * @brief Signalled when a task is submitted or the pool is stopped.
+     */
+    std::condition_variable m_task_cv;
+
+    /**
+     * @brief Signalled when all pending tasks are finished.
+     */
+    std::condition_variable m_done_cv;
+};
+
+} // namespace ir
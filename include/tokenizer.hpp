@@ -1,20 +1,57 @@
 #pragma once
 
 #include "defs.hpp"
+#include "term_cache.hpp"
+#include "vocabulary.hpp"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 namespace ir {
 
+/**
+ * @brief Call the given function with every token of the given string, where
+ * tokens are the maximal runs of non-whitespace characters.
+ *
+ * The string is read only once and no token is copied; each token is passed
+ * as a view into str.
+ *
+ * @tparam Function Function type callable with a std::string_view.
+ * @param str Input string to tokenize.
+ * @param f Function to call with each token in order.
+ */
+template <typename Function>
+void for_each_token(std::string_view str, Function&& f) {
+    auto is_space = [](const char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+               c == '\f';
+    };
+
+    size_t i = 0;
+    while (i < str.size()) {
+        // skip whitespace before the token
+        while (i < str.size() && is_space(str[i])) {
+            ++i;
+        }
+        const size_t begin = i;
+        while (i < str.size() && !is_space(str[i])) {
+            ++i;
+        }
+        if (i > begin) {
+            f(str.substr(begin, i - begin));
+        }
+    }
+}
+
 /**
  * @brief Split the given string with respect to whitespace characters and
- * return the resulting tokens and their positions in the document as a
- * vector.
+ * return the resulting tokens as a vector.
  *
  * @param str Input string to tokenize.
  *
- * @return std::vector of pairs containing the tokens and their positions.
+ * @return std::vector of tokens.
  */
 std::vector<std::string> tokenize(const std::string& str);
 
@@ -36,13 +73,36 @@ std::string remove_punctuation(const std::string& token);
  *
  * This function tokenizes the given raw document by splitting it by
  * whitespace, and then does normalization operations to each token as
- * defined in ir::normalize.
+ * defined in ir::normalize. Each normalized term is interned into the given
+ * vocabulary and the resulting document stores only term IDs.
+ *
+ * @param doc A raw document stored as ir::RawDocument.
+ * @param vocab Vocabulary used to map normalized terms to their IDs. Terms
+ * not in the vocabulary are inserted.
+ *
+ * @return Normalized version of the given raw document.
+ */
+NormalizedDocument normalize_document(const RawDocument& doc,
+                                      Vocabulary& vocab);
+
+/**
+ * @brief Tokenize and normalize a given raw document using a normalization
+ * cache and return an ir::NormalizedDocument object.
+ *
+ * The result is the same as the result of normalize_document without a cache;
+ * tokens seen before are mapped to their term IDs without normalizing them
+ * again.
  *
  * @param doc A raw document stored as ir::RawDocument.
+ * @param vocab Vocabulary used to map normalized terms to their IDs. Terms
+ * not in the vocabulary are inserted.
+ * @param cache Cache of previously normalized tokens. See ir::TermCache for
+ * which vocabularies it can be used with.
  *
  * @return Normalized version of the given raw document.
  */
-NormalizedDocument normalize_document(const RawDocument& doc);
+NormalizedDocument normalize_document(const RawDocument& doc,
+                                      Vocabulary& vocab, TermCache& cache);
 
 /**
  * @brief Return the normalized version a given token.
@@ -68,6 +128,20 @@ NormalizedDocument normalize_document(const RawDocument& doc);
  */
 std::string normalize(const std::string& token);
 
+/**
+ * @brief Normalize the given token into the given string.
+ *
+ * The result is the same as the result of normalize(const std::string&).
+ * Punctuation removal and case folding are done in a single pass over the
+ * token, and the term is stemmed in-place; hence, no memory is allocated once
+ * term has enough capacity.
+ *
+ * @param token Token to normalize.
+ * @param term String to store the normalized version of the token. If the
+ * given token is a stopword, it is set to an empty string.
+ */
+void normalize(std::string_view token, std::string& term);
+
 /**
  * @brief Normalize all the tokens in the given vector of tokens
  * in-place.
@@ -83,27 +157,55 @@ void normalize_all(std::vector<std::string>& token_vec);
 /**
  * @brief Check whether the input string is a stopword.
  *
- * This function simply checks if the given word is in the stopword list
- * defined in ir::STOPWORD_PATH.
- *
- * For efficiency purposes, the file is read only once when the function
- * is called for the first time, and the stopword list is sorted. Then,
- * stopword check is done using binary search.
+ * By default, the stopword list compiled into the binary (see
+ * ir::DefaultStopwords) is used, and the check is a lookup in a perfect hash
+ * set which neither allocates nor touches the filesystem. If a custom list is
+ * loaded with ir::load_stopwords, it is used instead. The function can be
+ * called from multiple threads concurrently.
  *
  * @param word Word to check if it is a stopword.
  *
  * @return true if word is in stopword list; false, otherwise.
  */
-bool is_stopword(const std::string& word);
+bool is_stopword(std::string_view word);
+
+/**
+ * @brief Replace the default stopword list with the whitespace separated words
+ * in the given file.
+ *
+ * The file is read once and its words are used by every subsequent call to
+ * ir::is_stopword. This function must be called before any document is
+ * normalized, and not concurrently with normalization; tokens already cached
+ * in an ir::TermCache are not affected. The same stopword list must be used
+ * when building and when using an idf model.
+ *
+ * @param filepath Path of the stopword file.
+ * @throw std::runtime_error if the file can't be opened.
+ */
+void load_stopwords(const std::string& filepath);
+
+/**
+ * @brief Return a hash of the stopword list used by ir::is_stopword.
+ *
+ * Equal lists have equal hashes regardless of whether they are the default
+ * list or loaded from a file, so the hash identifies how documents are
+ * normalized (see ir::DocumentCache).
+ *
+ * @return Hash of the sorted stopword list.
+ */
+std::uint64_t stopwords_fingerprint();
 
 /**
  * @brief Return normalized versions of the given raw document index.
  *
  * @param raw_docs Mapping from document ID to ir::RawDocument objects.
+ * @param vocab Vocabulary used to map normalized terms to their IDs. Terms
+ * not in the vocabulary are inserted.
  * @return Normalized versions of the given raw documents as a mapping from
  * document IDs to ir::NormalizedDocument objects.
  */
 std::unordered_map<size_t, ir::NormalizedDocument>
 normalized_docs_from_raw_docs(
-    const std::unordered_map<size_t, ir::RawDocument>& raw_docs);
+    const std::unordered_map<size_t, ir::RawDocument>& raw_docs,
+    Vocabulary& vocab);
 } // namespace ir
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "matrix.hpp"
+#include "sparse.hpp"
+#include <cstddef>
+#include <utility>
+
+namespace ir {
+
+/**
+ * @brief Sparse transition probability matrix of a Markov Chain over a graph
+ * with teleportation (damping).
+ *
+ * The matrix represented by this class is
+ *
+ * \f[
+ *     T = (1 - d)P + \frac{d}{N}\boldsymbol{1}\boldsymbol{1}^T
+ * \f]
+ *
+ * where \f$P\f$ is the column-normalized adjacency matrix of the graph,
+ * \f$d\f$ is the damping factor and \f$N\f$ is the number of states. Only
+ * the nonzero entries of \f$P\f$ are stored; the teleportation term is a
+ * rank-one correction applied during multiplication. Hence, memory usage and
+ * the cost of a matrix-vector product are \f$O(E + N)\f$ where \f$E\f$ is the
+ * number of edges, instead of \f$O(N^2)\f$.
+ */
+class TransitionMatrix {
+  public:
+    /**
+     * @brief Default constructor constructing an empty matrix.
+     */
+    TransitionMatrix() = default;
+
+    /**
+     * @brief Construct a transition matrix from the link probabilities of a
+     * graph and a damping factor.
+     *
+     * @param links Row \f$i\f$ stores \f$P_{ij}\f$ for each state \f$j\f$
+     * with an edge to state \f$i\f$, sorted by \f$j\f$. Each column of
+     * \f$P\f$ must sum to 1.
+     * @param damping_factor Teleportation probability \f$d\f$.
+     */
+    TransitionMatrix(SparseRows<double> links, double damping_factor)
+        : m_links(std::move(links)), m_damping_factor(damping_factor) {}
+
+    /**
+     * @brief Compute \f$y = Tx\f$.
+     *
+     * @param x Vector of size size().
+     * @param y Vector of size size() to store the result. Must not be x.
+     */
+    void multiply(const Vector<double>& x, Vector<double>& y) const;
+
+    /**
+     * @brief Return the number of states.
+     *
+     * @return Number of rows (and columns) of the matrix.
+     */
+    size_t size() const { return m_links.rows(); }
+
+    /**
+     * @brief Return the number of stored link probabilities.
+     *
+     * @return Number of nonzero entries of \f$P\f$.
+     */
+    size_t links_size() const { return m_links.entries(); }
+
+    /**
+     * @brief Return the link probabilities \f$P\f$.
+     *
+     * @return const-reference to the sparse rows of \f$P\f$.
+     */
+    const SparseRows<double>& links() const { return m_links; }
+
+    /**
+     * @brief Return the damping factor.
+     *
+     * @return Damping factor \f$d\f$.
+     */
+    double damping_factor() const { return m_damping_factor; }
+
+  private:
+    /**
+     * @brief Link probabilities \f$P\f$ stored by rows.
+     */
+    SparseRows<double> m_links;
+
+    /**
+     * @brief Damping factor \f$d\f$.
+     */
+    double m_damping_factor = 0;
+};
+
+/**
+ * @brief Multiply a transition matrix with a vector and return the result.
+ *
+ * @param matrix Transition matrix.
+ * @param vector Vector of size matrix.size().
+ * @return Product of the matrix and the vector.
+ */
+Vector<double> operator*(const TransitionMatrix& matrix,
+                         const Vector<double>& vector);
+
+} // namespace ir
@@ -11,8 +11,9 @@ namespace ir {
  * @brief Split the given input string using one of the delimeters and return
  * a vector of tokens.
  *
- * This function is a wrapper around well-known C strtok function to tokenize
- * a string using a list of delimiters.
+ * This function is a wrapper around the reentrant version of well-known C
+ * strtok function, strtok_r, to tokenize a string using a list of delimiters.
+ * Therefore, it can be called from multiple threads concurrently.
  *
  * @param str String to tokenize. Characters that are one of the given
  * delimiters will be replaced by the NULL character.
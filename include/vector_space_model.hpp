@@ -1,13 +1,55 @@
 #pragma once
 
 #include "defs.hpp"
+#include "idf_model.hpp"
+#include "sparse.hpp"
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace ir {
 
+/**
+ * @brief Treatment of terms missing from the idf model (out-of-vocabulary
+ * terms) when tf-idf vectors are computed.
+ *
+ * Terms are missing if they don't occur in the corpus, or if they are too
+ * rare for a pruned model (see ir::IdfModel::pruned). Terms that are too
+ * common for a pruned model aren't missing; their idf score is 0.
+ */
+enum class OovPolicy {
+    /**
+     * @brief Leave the terms out of the vectors.
+     */
+    Ignore,
+
+    /**
+     * @brief Throw std::out_of_range.
+     */
+    Error,
+
+    /**
+     * @brief Weight the terms by ir::IdfModel::oov_idf as if they occurred
+     * in as many documents as a rare term missing from the model can, which
+     * is a single document unless the model is approximate or pruned by a
+     * minimum document frequency.
+     */
+    MaxIdf
+};
+
+/**
+ * @brief Return the OOV policy with the given name.
+ *
+ * @param name One of "ignore", "error" and "max-idf".
+ * @return OOV policy.
+ *
+ * @throw std::invalid_argument if there is no policy with the given name.
+ */
+OovPolicy oov_policy_from_name(const std::string& name);
+
 /**
  * @brief Calculate idf value of every term in the given document corpus and
- * return the result as a mapping from terms to their idf values.
+ * return the result as a vector indexed by term IDs.
  *
  * This function computes the idf score of every term. idf value of term \f$t\f$
  * is defined as
@@ -22,10 +64,13 @@ namespace ir {
  *
  * @param document_corpus Document corpus to use when calculating idf scores.
  * idf score of every term in this corpus will be calculated.
- * @return A mapping from terms to their idf scores.
+ * @param n_terms Number of terms in the vocabulary used to normalize the
+ * corpus. Every term ID in the corpus must be less than this value.
+ * @return A vector storing idf score of each term at the index of its term ID.
  */
-std::unordered_map<std::string, double> idf_scores(
-    const std::unordered_map<size_t, ir::NormalizedDocument>& document_corpus);
+std::vector<double> idf_scores(
+    const std::unordered_map<size_t, ir::NormalizedDocument>& document_corpus,
+    size_t n_terms);
 
 /**
  * @brief Calculate tf-idf vector of every sentence in the given document and
@@ -35,34 +80,63 @@ std::unordered_map<std::string, double> idf_scores(
  * and returns the vectors in the same order. tf-idf vectors of golden standard
  * summary sentences are not calculated.
  *
- * For efficiency reasons, tf-idf vectors are stored as unordered maps. Terms
- * whose tf-idf value is very close to 0 are not included in the returned maps.
- * Therefore, the returned maps contain terms and their tf-idf values which are
- * different than 0.
+ * For efficiency reasons, tf-idf vectors are stored as sparse rows sorted by
+ * term ID in a single ir::SparseRows object. Terms whose tf-idf value is very
+ * close to 0 are not included in the returned rows. Therefore, the returned
+ * rows contain terms and their tf-idf values which are different than 0.
+ * Terms missing from the model (term IDs not less than its size) are handled
+ * according to the given OOV policy before their tf-idf values are computed.
+ *
+ * Every nonempty returned vector is scaled to unit Euclidean length so that
+ * cosine similarity of two vectors reduces to their dot product (see
+ * ir::cosine_sim). Sentences whose tf-idf values are all 0 have empty rows.
  *
  * @param norm_doc Normalized document containing sentences whose tf-idf vectors
  * will be calculated.
- * @param idf_scores A mapping from terms to their idf scores.
- * @return Vector of tf-idf maps. Each entry of the returned vector contains the
- * tf-idf map of the corresponding sentence in the given document, in the same
- * order.
+ * @param idf_model Model storing the idf score of each term at its term ID.
+ * @param oov Treatment of terms missing from the model.
+ * @return Unit length tf-idf vectors. Each row contains the tf-idf vector of
+ * the corresponding sentence in the given document, in the same order.
+ *
+ * @throw std::out_of_range if a term is missing from the model and oov is
+ * ir::OovPolicy::Error.
+ */
+SparseRows<double> tf_idf_vectors(const ir::NormalizedDocument& norm_doc,
+                                  const IdfModel& idf_model,
+                                  OovPolicy oov = OovPolicy::Ignore);
+
+/**
+ * @brief Return the Euclidean length of the given tf-idf vector.
+ *
+ * @param vec tf-idf vector containing term IDs and their tf-idf values.
+ * @return Euclidean length of the given tf-idf vector.
  */
-std::vector<std::unordered_map<std::string, double>>
-tf_idf_maps(const ir::NormalizedDocument& norm_doc,
-            const std::unordered_map<std::string, double>& idf_scores);
+double euc_len(const SparseRow<double>& vec);
 
 /**
- * @brief Return the Euclidean length of the given tf-idf map.
+ * @brief Calculate the dot product of two given sparse vectors.
+ *
+ * Since the entries of both vectors are sorted by term ID, common terms are
+ * found by intersecting the two sorted term sequences. The intersection
+ * strategy is chosen according to the vector sizes:
  *
- * @param vec tf-idf map containing terms and their tf-idf values.
- * @return Euclidean length of the given tf-idf map.
+ * 1. If one vector is much longer than the other, each term of the shorter
+ * vector is searched in the longer one using galloping (exponential) search.
+ * 2. If both vectors are long, term IDs are compared 4x4 at a time using SIMD
+ * instructions (when available).
+ * 3. Otherwise, a scalar merge pass is used.
+ *
+ * @param vec1 First vector.
+ * @param vec2 Second vector.
+ * @return Dot product of the given vectors.
  */
-double euc_len(const std::unordered_map<std::string, double>& vec);
+double sparse_dot(const SparseRow<double>& vec1, const SparseRow<double>& vec2);
 
 /**
- * @brief Calculate the cosine similarity between two given tf-idf maps.
+ * @brief Calculate the cosine similarity between two given unit length tf-idf
+ * vectors.
  *
- * Cosine similarity of two tf-idf maps represented as \f$M_1, M_2\f$ are
+ * Cosine similarity of two tf-idf vectors represented as \f$M_1, M_2\f$ are
  * calculated as follows:
  *
  * \f[
@@ -70,12 +144,16 @@ double euc_len(const std::unordered_map<std::string, double>& vec);
  * \f]
  *
  * where \f$|\cdot|\f$ represents the Euclidean norm and \f$M_1[w]\f$ is the
- * tf-idf value of word \f$w\f$ in map \f$M_1\f$.
+ * tf-idf value of word \f$w\f$ in vector \f$M_1\f$.
+ *
+ * Vectors returned by ir::tf_idf_vectors are already normalized, i.e.
+ * \f$|M_1| = |M_2| = 1\f$. Hence, the norms are not recomputed and the
+ * cosine similarity is simply ir::sparse_dot of the two vectors. If any of the
+ * vectors is empty, the similarity is 0.
  *
- * @param vec1 First tf-idf map.
- * @param vec2 Second tf-idf map.
- * @return Cosine similarity between the given tf-idf maps.
+ * @param vec1 First unit length tf-idf vector.
+ * @param vec2 Second unit length tf-idf vector.
+ * @return Cosine similarity between the given tf-idf vectors.
  */
-double cosine_sim(const std::unordered_map<std::string, double>& vec1,
-                  const std::unordered_map<std::string, double>& vec2);
+double cosine_sim(const SparseRow<double>& vec1, const SparseRow<double>& vec2);
 } // namespace ir
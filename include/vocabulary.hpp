@@ -0,0 +1,133 @@
+#pragma once
+
+#include "defs.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ir {
+
+class IdfModel;
+
+/**
+ * @brief A bidirectional mapping between normalized terms and dense integer
+ * term IDs.
+ *
+ * Every distinct term interned into a vocabulary is assigned the next unused
+ * ID starting from 0. Hence, the IDs of a vocabulary of size \f$N\f$ are
+ * exactly \f$0, 1, \dots, N - 1\f$ and can be used to index plain vectors
+ * (such as idf tables) directly.
+ *
+ * Strings are hashed only once per token when a document is normalized; all
+ * subsequent stages (tf-idf computation, similarity, idf lookup) operate on
+ * the integer IDs.
+ *
+ * A vocabulary can be layered on top of a read-only ir::IdfModel. In that
+ * case, terms of the model keep their model IDs \f$0, \dots, M - 1\f$, and
+ * only the terms missing from the model are stored in the vocabulary itself
+ * with IDs starting from \f$M\f$. These terms have no idf score.
+ */
+class Vocabulary {
+  public:
+    /**
+     * @brief Default constructor constructing an empty vocabulary.
+     */
+    Vocabulary() = default;
+
+    /**
+     * @brief Construct an empty vocabulary layered on top of the given idf
+     * model.
+     *
+     * @param base Model whose terms and IDs are used as they are. Must outlive
+     * this vocabulary.
+     */
+    explicit Vocabulary(const IdfModel& base);
+
+    /**
+     * @brief Return the ID of the given term, inserting it to the vocabulary
+     * if it doesn't exist.
+     *
+     * @param term Normalized term.
+     * @return ID of the term.
+     */
+    term_id intern(const std::string& term);
+
+    /**
+     * @brief Return the ID of the given term without modifying the
+     * vocabulary.
+     *
+     * @param term Normalized term.
+     * @return ID of the term if it exists; ir::InvalidTermID, otherwise.
+     */
+    term_id find(const std::string& term) const;
+
+    /**
+     * @brief Return the term with the given ID.
+     *
+     * @param id ID of the term. Must be less than size().
+     * @return Copy of the term string.
+     */
+    std::string term(term_id id) const;
+
+    /**
+     * @brief Return the number of terms in this vocabulary including those of
+     * the base model.
+     *
+     * @return Number of terms.
+     */
+    size_t size() const { return m_base_size + m_terms.size(); }
+
+    /**
+     * @brief Return the base model of this vocabulary.
+     *
+     * @return Pointer to the base model; nullptr if the vocabulary is
+     * standalone.
+     */
+    const IdfModel* base() const { return m_base; }
+
+    /**
+     * @brief Return the number of terms of the base model.
+     *
+     * @return Number of base model terms; 0 if the vocabulary is standalone.
+     */
+    size_t base_size() const { return m_base_size; }
+
+    /**
+     * @brief Return the generation of the ID space of this vocabulary.
+     *
+     * Vocabularies layered on the same ir::IdfModel share the model's IDs,
+     * and hence its generation; any other vocabulary has its own.
+     *
+     * @return Generation of the ID space (see ir::IdSpace).
+     */
+    std::uint64_t id_space() const;
+
+  private:
+    /**
+     * @brief Base model; nullptr if the vocabulary is standalone.
+     */
+    const IdfModel* m_base = nullptr;
+
+    /**
+     * @brief Number of terms of the base model.
+     */
+    size_t m_base_size = 0;
+
+    /**
+     * @brief Mapping from terms to their IDs.
+     */
+    std::unordered_map<std::string, term_id> m_ids;
+
+    /**
+     * @brief Terms stored at the index of their IDs minus the base model
+     * size.
+     */
+    std::vector<std::string> m_terms;
+
+    /**
+     * @brief Identity of the IDs of a standalone vocabulary.
+     */
+    IdSpace m_id_space;
+};
+
+} // namespace ir
@@ -0,0 +1,314 @@
+#include "approximate_frequencies.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include "tokenizer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Number of terms after which the vocabulary a thread normalizes
+ * documents with is discarded.
+ */
+static const size_t ThreadVocabularyLimit = 1 << 16;
+
+ir::ApproximateDocumentFrequencies::ApproximateDocumentFrequencies(
+    size_t memory_budget)
+    : m_sketch(std::max<size_t>(1, memory_budget / 2 / DefaultSketchDepth /
+                                       sizeof(std::uint32_t))),
+      m_capacity(memory_budget / 2 / HeavyHitterBytes) {
+    if (memory_budget / 2 / DefaultSketchDepth / sizeof(std::uint32_t) == 0 ||
+        m_capacity == 0) {
+        throw std::invalid_argument(
+            "Memory budget is too small for approximate document "
+            "frequencies");
+    }
+}
+
+bool ir::ApproximateDocumentFrequencies::evicted_before(
+    const Table::value_type* left, const Table::value_type* right) {
+    if (left->second.count != right->second.count) {
+        return left->second.count < right->second.count;
+    }
+    return left->first > right->first;
+}
+
+void ir::ApproximateDocumentFrequencies::sift_down(size_t index) {
+    while (true) {
+        size_t smallest = index;
+        for (size_t child = 2 * index + 1;
+             child <= 2 * index + 2 && child < m_heap.size(); ++child) {
+            if (evicted_before(m_heap[child], m_heap[smallest])) {
+                smallest = child;
+            }
+        }
+        if (smallest == index) {
+            return;
+        }
+        std::swap(m_heap[index], m_heap[smallest]);
+        m_heap[index]->second.heap_index = index;
+        m_heap[smallest]->second.heap_index = smallest;
+        index = smallest;
+    }
+}
+
+void ir::ApproximateDocumentFrequencies::sift_up(size_t index) {
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (not evicted_before(m_heap[index], m_heap[parent])) {
+            return;
+        }
+        std::swap(m_heap[index], m_heap[parent]);
+        m_heap[index]->second.heap_index = index;
+        m_heap[parent]->second.heap_index = parent;
+        index = parent;
+    }
+}
+
+void ir::ApproximateDocumentFrequencies::add(
+    const std::vector<std::string>& doc_terms) {
+    for (const auto& term : doc_terms) {
+        // the sketch counts every term, so that terms that are replaced in
+        // the table can enter it again with a good estimate
+        const size_t estimate = m_sketch.add(term);
+
+        const auto it = m_table.find(term);
+        if (it != m_table.end()) {
+            // counts only grow, so the entry moves away from the top
+            ++it->second.count;
+            sift_down(it->second.heap_index);
+        } else if (m_heap.size() < m_capacity) {
+            // if no term was dropped yet, this is the first occurrence
+            const size_t count = m_dropped ? estimate : 1;
+            auto& entry = *m_table.emplace(term, HeavyHitter{count, 0}).first;
+            entry.second.heap_index = m_heap.size();
+            m_heap.push_back(&entry);
+            sift_up(m_heap.size() - 1);
+        } else if (estimate > m_heap.front()->second.count) {
+            // replace the term with the smallest count
+            m_dropped = true;
+            m_missing_df = std::max(m_missing_df, m_heap.front()->second.count);
+            m_table.erase(m_heap.front()->first);
+            auto& entry =
+                *m_table.emplace(term, HeavyHitter{estimate, 0}).first;
+            m_heap.front() = &entry;
+            sift_down(0);
+        } else {
+            m_dropped = true;
+            m_missing_df = std::max(m_missing_df, estimate);
+        }
+    }
+
+    ++m_n_docs;
+}
+
+void ir::ApproximateDocumentFrequencies::merge(
+    const ApproximateDocumentFrequencies& other) {
+    // count each term of a table in the other object by the other sketch;
+    // a term missing from a table without drops doesn't occur in its object
+    for (auto& entry : m_table) {
+        const auto it = other.m_table.find(entry.first);
+        if (it != other.m_table.end()) {
+            entry.second.count += it->second.count;
+        } else if (other.m_dropped) {
+            entry.second.count += other.m_sketch.estimate(entry.first);
+        }
+    }
+    for (const auto& entry : other.m_table) {
+        if (m_table.find(entry.first) == m_table.end()) {
+            const size_t count =
+                entry.second.count +
+                (m_dropped ? m_sketch.estimate(entry.first) : 0);
+            m_table.emplace(entry.first, HeavyHitter{count, 0});
+        }
+    }
+    m_dropped = m_dropped || other.m_dropped;
+    // a term missing from both tables is counted at most by both bounds
+    m_missing_df += other.m_missing_df;
+    m_sketch.merge(other.m_sketch);
+    m_capacity += other.m_capacity;
+    m_n_parts += other.m_n_parts;
+    m_n_docs += other.m_n_docs;
+
+    // counts changed arbitrarily; rebuild the heap
+    m_heap.clear();
+    for (auto& entry : m_table) {
+        entry.second.heap_index = m_heap.size();
+        m_heap.push_back(&entry);
+    }
+    for (size_t i = m_heap.size() / 2; i-- > 0;) {
+        sift_down(i);
+    }
+}
+
+ir::DocumentFrequencies
+ir::ApproximateDocumentFrequencies::document_frequencies() const {
+    std::vector<std::string> terms;
+    std::vector<size_t> doc_freqs;
+    terms.reserve(m_table.size());
+    doc_freqs.reserve(m_table.size());
+    for (const auto& entry : m_table) {
+        terms.push_back(entry.first);
+        doc_freqs.push_back(entry.second.count);
+    }
+
+    DocumentFrequencies result(terms, doc_freqs, m_n_docs, m_dropped,
+                               m_missing_df);
+    result.sort_terms();
+    return result;
+}
+
+/**
+ * @brief Parse and normalize every document in the given file list using
+ * multiple threads and pass the distinct terms of each document to a count
+ * function.
+ *
+ * The file list is split into contiguous slices, one per thread, and each
+ * thread counts its slice into its own partial result. Each thread
+ * normalizes documents with a vocabulary that is discarded whenever it has
+ * more than ThreadVocabularyLimit terms.
+ *
+ * @param file_list List of document files.
+ * @param n_threads Number of threads to use. If 0, the number of hardware
+ * threads is used.
+ * @param make_partial Function returning an empty partial result given the
+ * number of slices.
+ * @param count Function counting the distinct terms of a document (a
+ * std::vector<std::string>) into a partial result.
+ * @param term_stats If not nullptr, the counters of the token caches of all
+ * threads are added here.
+ * @return Partial result of each slice in the order of the slices.
+ *
+ * @throw std::runtime_error if a document file can't be read.
+ */
+template <typename MakePartial, typename Count>
+static auto count_document_terms(const std::vector<std::string>& file_list,
+                                 size_t n_threads, MakePartial make_partial,
+                                 Count count,
+                                 ir::TermCacheStats* term_stats = nullptr) {
+    ir::ThreadPool pool(n_threads);
+    const size_t n_slices = std::min(pool.size(), file_list.size());
+
+    std::vector<decltype(make_partial(n_slices))> partials;
+    for (size_t t = 0; t < n_slices; ++t) {
+        partials.push_back(make_partial(n_slices));
+    }
+    // first file of each slice that couldn't be read; empty if none
+    std::vector<std::string> unreadable(n_slices);
+    std::vector<ir::TermCacheStats> slice_term_stats(n_slices);
+
+    for (size_t t = 0; t < n_slices; ++t) {
+        const size_t begin = file_list.size() * t / n_slices;
+        const size_t end = file_list.size() * (t + 1) / n_slices;
+
+        pool.submit([&file_list, &partials, &unreadable, &slice_term_stats,
+                     &count, t, begin, end] {
+            ir::Vocabulary vocab;
+            ir::TermCache cache;
+            std::vector<ir::term_id> ids;
+            std::vector<std::string> doc_terms;
+
+            for (size_t i = begin; i < end; ++i) {
+                std::ifstream ifs(file_list[i]);
+                if (not ifs) {
+                    unreadable[t] = file_list[i];
+                    return;
+                }
+                const ir::RawDocument raw_doc = ir::parse_doc_file(ifs);
+                if (ifs.bad()) {
+                    unreadable[t] = file_list[i];
+                    return;
+                }
+                const ir::NormalizedDocument doc =
+                    ir::normalize_document(raw_doc, vocab, cache);
+
+                const auto& terms = doc.sentence_term_counts.terms();
+                ids.assign(terms.begin(), terms.end());
+                std::sort(ids.begin(), ids.end());
+                ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+                doc_terms.clear();
+                for (const ir::term_id id : ids) {
+                    doc_terms.push_back(vocab.term(id));
+                }
+                count(partials[t], doc_terms);
+
+                // the cache stores IDs of the discarded vocabulary
+                if (vocab.size() > ThreadVocabularyLimit) {
+                    vocab = ir::Vocabulary();
+                    cache.clear();
+                }
+            }
+            slice_term_stats[t].add(cache);
+        });
+    }
+    pool.wait();
+
+    // an unreadable document would be counted as an empty one
+    for (const std::string& path : unreadable) {
+        if (not path.empty()) {
+            throw std::runtime_error("Couldn't read " + path);
+        }
+    }
+
+    if (term_stats != nullptr) {
+        for (const auto& slice_stats : slice_term_stats) {
+            term_stats->add(slice_stats);
+        }
+    }
+    return partials;
+}
+
+ir::ApproximateDocumentFrequencies ir::corpus_approximate_document_frequencies(
+    const std::vector<std::string>& file_list, size_t n_threads,
+    size_t memory_budget, TermCacheStats* term_stats) {
+    const auto make_partial = [memory_budget](size_t n_slices) {
+        return ApproximateDocumentFrequencies(memory_budget / n_slices);
+    };
+    const auto count = [](ApproximateDocumentFrequencies& partial,
+                          const std::vector<std::string>& doc_terms) {
+        partial.add(doc_terms);
+    };
+    auto partials = count_document_terms(file_list, n_threads, make_partial,
+                                         count, term_stats);
+
+    if (partials.empty()) {
+        return ApproximateDocumentFrequencies(memory_budget);
+    }
+    for (size_t t = 1; t < partials.size(); ++t) {
+        partials[0].merge(partials[t]);
+    }
+    return std::move(partials[0]);
+}
+
+std::vector<size_t>
+ir::term_document_frequencies(const std::vector<std::string>& file_list,
+                              const std::vector<std::string>& terms,
+                              size_t n_threads) {
+    assert(std::is_sorted(terms.begin(), terms.end()));
+
+    const auto make_partial = [&terms](size_t) {
+        return std::vector<size_t>(terms.size(), 0);
+    };
+    const auto count = [&terms](std::vector<size_t>& partial,
+                                const std::vector<std::string>& doc_terms) {
+        for (const auto& term : doc_terms) {
+            const auto it = std::lower_bound(terms.begin(), terms.end(), term);
+            if (it != terms.end() && *it == term) {
+                ++partial[it - terms.begin()];
+            }
+        }
+    };
+    const auto partials =
+        count_document_terms(file_list, n_threads, make_partial, count);
+
+    std::vector<size_t> result(terms.size(), 0);
+    for (const auto& partial : partials) {
+        for (size_t i = 0; i < result.size(); ++i) {
+            result[i] += partial[i];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,247 @@
+#include "batch.hpp"
+#include "file_manager.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <utility>
+
+/**
+ * @brief State of a worker of run_batch, reused for every input it
+ * processes.
+ */
+struct WorkerState {
+    /**
+     * @brief Model term ID of each cache term ID looked up by the worker
+     * (see ir::DocumentCache::document).
+     */
+    std::vector<ir::term_id> cache_ids;
+
+    /**
+     * @brief Sums of the LSH statistics of the documents summarized by the
+     * worker.
+     */
+    ir::LshStats lsh;
+
+    /**
+     * @brief Cache of the normalized tokens of the documents summarized by
+     * the worker.
+     */
+    ir::TermCache term_cache;
+};
+
+/**
+ * @brief Add the counts of the given LSH statistics to the sums.
+ */
+static void add_lsh_stats(ir::LshStats& sums, const ir::LshStats& stats) {
+    sums.candidates += stats.candidates;
+    sums.edges += stats.edges;
+    sums.sample_edges += stats.sample_edges;
+    sums.sample_found += stats.sample_found;
+}
+
+/**
+ * @brief Summarize the inputs returned by next_input on a thread pool and
+ * write their results in the input order.
+ *
+ * Inputs are claimed one at a time under a lock, so next_input needn't be
+ * thread-safe, and are converted to result lines by process concurrently.
+ * Finished results are buffered until every earlier result is written, and
+ * no input is claimed while options.window inputs are being processed or
+ * buffered.
+ *
+ * @param next_input Function storing the next input in its argument and
+ * returning false if there are no more inputs.
+ * @param process Function writing the result line of an input to a stream
+ * and returning false if the input couldn't be summarized, given the state
+ * of the calling worker. It must not throw.
+ * @param os Output stream to write the results.
+ * @param options Batch options.
+ * @return Batch statistics.
+ */
+template <typename NextInput, typename Process>
+static ir::BatchStats run_batch(NextInput next_input, Process process,
+                                std::ostream& os,
+                                const ir::BatchOptions& options) {
+    assert(options.window > 0);
+
+    std::mutex mutex;
+    std::condition_variable window_cv;
+    bool input_done = false;
+    size_t next_claim = 0;
+    size_t next_write = 0;
+    std::map<size_t, std::string> finished;
+    ir::BatchStats stats;
+
+    const auto work = [&] {
+        WorkerState state;
+        std::string input;
+        std::ostringstream result;
+        while (true) {
+            size_t seq;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                window_cv.wait(lock, [&] {
+                    return input_done ||
+                           next_claim < next_write + options.window;
+                });
+                if (input_done || not next_input(input)) {
+                    input_done = true;
+                    window_cv.notify_all();
+                    add_lsh_stats(stats.lsh, state.lsh);
+                    stats.term_cache.add(state.term_cache);
+                    return;
+                }
+                seq = next_claim++;
+            }
+
+            result.str("");
+            const bool ok = process(input, result, state);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.documents;
+            stats.failed += not ok;
+            finished.emplace(seq, result.str());
+
+            // write every result whose predecessors are all written
+            for (auto it = finished.begin();
+                 it != finished.end() && it->first == next_write;
+                 it = finished.erase(it)) {
+                os << it->second;
+                ++next_write;
+            }
+            window_cv.notify_all();
+        }
+    };
+
+    ir::ThreadPool pool(options.n_threads);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        pool.submit(work);
+    }
+    pool.wait();
+
+    assert(finished.empty());
+    os << std::flush;
+    if (stats.lsh.sample_edges > 0) {
+        stats.lsh.recall = static_cast<double>(stats.lsh.sample_found) /
+                           static_cast<double>(stats.lsh.sample_edges);
+    }
+    return stats;
+}
+
+/**
+ * @brief Summarize the given raw document, write its result line and add
+ * its statistics to the state of the worker.
+ *
+ * If norm_doc is given, it is summarized instead of normalizing raw_doc,
+ * which only provides the sentences of the summary.
+ *
+ * @return false if the document couldn't be summarized; true, otherwise.
+ */
+static bool write_result(std::ostream& os, const std::string& id,
+                         const ir::RawDocument& raw_doc,
+                         const ir::IdfModel& idf_model,
+                         const ir::BatchOptions& options, WorkerState& state,
+                         const ir::NormalizedDocument* norm_doc = nullptr) {
+    try {
+        const ir::Summary summary =
+            norm_doc ? ir::summarize(*norm_doc, idf_model, options.top_k,
+                                     options.lexrank)
+                     : ir::summarize(raw_doc, idf_model, options.top_k,
+                                     options.lexrank, state.term_cache);
+        ir::write_summary_json(os, id, summary, raw_doc);
+        add_lsh_stats(state.lsh, summary.stats.lsh);
+        return true;
+    } catch (const std::exception& e) {
+        ir::write_error_json(os, id, e.what());
+        return false;
+    }
+}
+
+ir::BatchStats ir::summarize_files(const std::vector<std::string>& file_list,
+                                   const IdfModel& idf_model, std::ostream& os,
+                                   const BatchOptions& options) {
+    size_t next_file = 0;
+    const auto next_input = [&file_list, &next_file](std::string& path) {
+        if (next_file == file_list.size()) {
+            return false;
+        }
+        path = file_list[next_file++];
+        return true;
+    };
+
+    const auto process = [&idf_model, &options](const std::string& path,
+                                                std::ostream& result,
+                                                WorkerState& state) {
+        const std::string id = doc_name_from_filepath(path);
+        if (options.cache == nullptr) {
+            std::ifstream ifs(path);
+            if (not ifs) {
+                ir::write_error_json(result, id, "File couldn't be opened");
+                return false;
+            }
+            const RawDocument raw_doc = parse_doc_file(ifs);
+            return write_result(result, id, raw_doc, idf_model, options,
+                                state);
+        }
+
+        // the raw document is still parsed for the summary sentences
+        std::string contents;
+        if (not read_file(path, contents)) {
+            ir::write_error_json(result, id, "File couldn't be opened");
+            return false;
+        }
+        std::istringstream iss(contents);
+        const RawDocument raw_doc = parse_doc_file(iss);
+
+        const size_t index = options.cache->find(id, content_hash(contents));
+        if (index == NoCachedDocument) {
+            return write_result(result, id, raw_doc, idf_model, options,
+                                state);
+        }
+        // terms missing from the model are kept local to this document;
+        // model terms have the same IDs in every document, so their IDs are
+        // remembered across all documents read by this worker
+        Vocabulary vocab(idf_model);
+        const NormalizedDocument norm_doc = options.cache->document(
+            index, vocab, state.cache_ids, idf_model.size());
+        return write_result(result, id, raw_doc, idf_model, options, state,
+                            &norm_doc);
+    };
+
+    return run_batch(next_input, process, os, options);
+}
+
+ir::BatchStats ir::summarize_jsonl(std::istream& is, const IdfModel& idf_model,
+                                   std::ostream& os,
+                                   const BatchOptions& options) {
+    const auto next_input = [&is](std::string& line) {
+        while (std::getline(is, line)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const auto process = [&idf_model, &options](const std::string& line,
+                                                std::ostream& result,
+                                                WorkerState& state) {
+        std::string id;
+        RawDocument raw_doc;
+        try {
+            raw_doc = parse_json_doc(line, id);
+        } catch (const std::exception& e) {
+            ir::write_error_json(result, id, e.what());
+            return false;
+        }
+        return write_result(result, id, raw_doc, idf_model, options, state);
+    };
+
+    return run_batch(next_input, process, os, options);
+}
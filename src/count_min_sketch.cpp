@@ -0,0 +1,81 @@
+#include "count_min_sketch.hpp"
+#include "perfect_hash_set.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Maximum depth of an ir::CountMinSketch, so that counter indices fit
+ * on the stack.
+ */
+static const size_t MaxSketchDepth = 16;
+
+ir::CountMinSketch::CountMinSketch(size_t width, size_t depth)
+    : m_depth(depth) {
+    assert(width > 0 && "Sketch width must be positive");
+    assert(depth > 0 && depth <= MaxSketchDepth && "Invalid sketch depth");
+
+    // round down to a power of two so that indices are masked
+    size_t pow2 = 1;
+    while (pow2 * 2 <= width) {
+        pow2 *= 2;
+    }
+    m_mask = pow2 - 1;
+    m_counters.assign(pow2 * depth, 0);
+}
+
+void ir::CountMinSketch::indices(std::string_view key, size_t* indices) const {
+    // double hashing: row i uses h1 + i * h2 with an odd h2
+    const std::uint64_t h1 = mix64(fnv1a64(key));
+    const std::uint64_t h2 = mix64(h1) | 1;
+    for (size_t row = 0; row < m_depth; ++row) {
+        indices[row] = row * width() + ((h1 + row * h2) & m_mask);
+    }
+}
+
+size_t ir::CountMinSketch::add(std::string_view key) {
+    size_t idx[MaxSketchDepth];
+    indices(key, idx);
+
+    std::uint32_t min = std::numeric_limits<std::uint32_t>::max();
+    for (size_t row = 0; row < m_depth; ++row) {
+        min = std::min(min, m_counters[idx[row]]);
+    }
+
+    // conservative update: counters above the new estimate already account
+    // for this occurrence
+    const std::uint32_t updated = min + 1;
+    for (size_t row = 0; row < m_depth; ++row) {
+        m_counters[idx[row]] = std::max(m_counters[idx[row]], updated);
+    }
+    ++m_total;
+
+    return updated;
+}
+
+size_t ir::CountMinSketch::estimate(std::string_view key) const {
+    size_t idx[MaxSketchDepth];
+    indices(key, idx);
+
+    std::uint32_t min = std::numeric_limits<std::uint32_t>::max();
+    for (size_t row = 0; row < m_depth; ++row) {
+        min = std::min(min, m_counters[idx[row]]);
+    }
+
+    return min;
+}
+
+void ir::CountMinSketch::merge(const CountMinSketch& other) {
+    assert(m_mask == other.m_mask && m_depth == other.m_depth &&
+           "Sketch dimensions must match in ir::CountMinSketch::merge");
+
+    for (size_t i = 0; i < m_counters.size(); ++i) {
+        m_counters[i] += other.m_counters[i];
+    }
+    m_total += other.m_total;
+}
+
+double ir::CountMinSketch::error_bound() const {
+    return std::exp(1.0) / width() * m_total;
+}
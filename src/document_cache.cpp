@@ -0,0 +1,392 @@
+#include "document_cache.hpp"
+#include "perfect_hash_set.hpp"
+#include "tokenizer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <numeric>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * @brief Magic bytes at the beginning of every document cache.
+ */
+static const char CacheMagic[8] = {'L', 'X', 'R', 'K', 'D', 'O', 'C', '\0'};
+
+/**
+ * @brief Header of the binary document cache format.
+ */
+struct CacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t stopwords;
+    std::uint64_t n_docs;
+    std::uint64_t n_terms;
+    std::uint64_t data_size;
+    std::uint64_t pool_size;
+};
+
+/**
+ * @brief Round the given byte count up to a multiple of 8.
+ */
+static size_t align8(size_t n_bytes) { return (n_bytes + 7) & ~size_t(7); }
+
+/**
+ * @brief Byte offsets of each section of a document cache.
+ */
+struct CacheSections {
+    size_t data;
+    size_t docs;
+    size_t terms;
+    size_t strings;
+    size_t end;
+};
+
+/**
+ * @brief Compute the section offsets of a cache with the given header.
+ */
+static CacheSections cache_sections(const CacheHeader& header) {
+    CacheSections result;
+    result.data = align8(sizeof(CacheHeader));
+    result.docs =
+        result.data + align8(header.data_size * sizeof(std::uint32_t));
+    result.terms =
+        result.docs + align8(header.n_docs * sizeof(ir::DocumentRecord));
+    result.strings = result.terms +
+                     align8((header.n_terms + 1) * sizeof(std::uint64_t));
+    result.end = result.strings + align8(header.pool_size);
+    return result;
+}
+
+std::uint64_t ir::content_hash(std::string_view contents) {
+    return mix64(fnv1a64(contents));
+}
+
+ir::DocumentCache::DocumentCache(const std::string& filepath) {
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Couldn't open document cache " + filepath);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(CacheHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Invalid document cache " + filepath);
+    }
+
+    const size_t n_bytes = static_cast<size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, n_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Couldn't map document cache " + filepath);
+    }
+
+    m_data = static_cast<const char*>(addr);
+    m_mapped_size = n_bytes;
+    try {
+        init_sections(n_bytes);
+    } catch (...) {
+        ::munmap(addr, n_bytes);
+        m_mapped_size = 0;
+        throw;
+    }
+}
+
+ir::DocumentCache::DocumentCache(DocumentCache&& other) noexcept {
+    *this = std::move(other);
+}
+
+ir::DocumentCache&
+ir::DocumentCache::operator=(DocumentCache&& other) noexcept {
+    if (this != &other) {
+        if (m_mapped_size != 0) {
+            ::munmap(const_cast<char*>(m_data), m_mapped_size);
+        }
+
+        m_data = other.m_data;
+        m_mapped_size = other.m_mapped_size;
+        m_n_docs = other.m_n_docs;
+        m_n_terms = other.m_n_terms;
+        m_docs = other.m_docs;
+        m_data_words = other.m_data_words;
+        m_term_offsets = other.m_term_offsets;
+        m_strings = other.m_strings;
+
+        other.m_data = nullptr;
+        other.m_mapped_size = 0;
+        other.m_n_docs = 0;
+        other.m_n_terms = 0;
+    }
+    return *this;
+}
+
+ir::DocumentCache::~DocumentCache() {
+    if (m_mapped_size != 0) {
+        ::munmap(const_cast<char*>(m_data), m_mapped_size);
+    }
+}
+
+void ir::DocumentCache::init_sections(size_t n_bytes) {
+    CacheHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+
+    if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+        header.version != DocumentCacheVersion) {
+        throw std::runtime_error("Unsupported document cache format");
+    }
+    if (header.stopwords != stopwords_fingerprint()) {
+        throw std::runtime_error(
+            "Document cache was built with a different stopword list");
+    }
+
+    // section sizes are bounded by the file size first, so that computing
+    // the section offsets can't overflow
+    if (header.n_docs > n_bytes || header.n_terms > n_bytes ||
+        header.data_size > n_bytes || header.pool_size > n_bytes) {
+        throw std::runtime_error("Corrupt document cache");
+    }
+    const CacheSections sections = cache_sections(header);
+    if (sections.end > n_bytes) {
+        throw std::runtime_error("Corrupt document cache");
+    }
+
+    // term() indexes the string pool by the term offsets
+    const auto* term_offsets =
+        reinterpret_cast<const std::uint64_t*>(m_data + sections.terms);
+    if (term_offsets[0] != 0 ||
+        term_offsets[header.n_terms] > header.pool_size ||
+        not std::is_sorted(term_offsets, term_offsets + header.n_terms + 1)) {
+        throw std::runtime_error("Corrupt document cache term offsets");
+    }
+
+    // name() and document_with() index the string pool and the document
+    // data by the records, and find() searches the records by name
+    const auto* docs =
+        reinterpret_cast<const DocumentRecord*>(m_data + sections.docs);
+    const auto* words =
+        reinterpret_cast<const std::uint32_t*>(m_data + sections.data);
+    const char* strings = m_data + sections.strings;
+    const auto record_name = [strings](const DocumentRecord& doc) {
+        return std::string_view(strings + doc.name_offset, doc.name_size);
+    };
+    for (size_t d = 0; d < header.n_docs; ++d) {
+        const DocumentRecord& doc = docs[d];
+        if (doc.name_size > header.pool_size ||
+            doc.name_offset > header.pool_size - doc.name_size ||
+            doc.n_sentences > header.data_size ||
+            doc.data_offset > header.data_size - doc.n_sentences ||
+            doc.n_entries >
+                (header.data_size - doc.data_offset - doc.n_sentences) / 2) {
+            throw std::runtime_error("Corrupt document cache record");
+        }
+        if (d > 0 && record_name(doc) < record_name(docs[d - 1])) {
+            throw std::runtime_error("Corrupt document cache record order");
+        }
+
+        const std::uint32_t* sizes = words + doc.data_offset;
+        const std::uint64_t n_entries =
+            std::accumulate(sizes, sizes + doc.n_sentences, std::uint64_t(0));
+        const std::uint32_t* entries = sizes + doc.n_sentences;
+        if (n_entries != doc.n_entries) {
+            throw std::runtime_error("Corrupt document cache document data");
+        }
+        for (size_t e = 0; e < n_entries; ++e) {
+            if (entries[2 * e] >= header.n_terms) {
+                throw std::runtime_error(
+                    "Corrupt document cache document data");
+            }
+        }
+    }
+
+    m_n_docs = header.n_docs;
+    m_n_terms = header.n_terms;
+    m_docs = docs;
+    m_data_words = words;
+    m_term_offsets = term_offsets;
+    m_strings = strings;
+}
+
+size_t ir::DocumentCache::find(std::string_view name,
+                               std::uint64_t hash) const {
+    const DocumentRecord* end = m_docs + m_n_docs;
+    const DocumentRecord* it = std::lower_bound(
+        m_docs, end, name, [this](const DocumentRecord& doc,
+                                  std::string_view key) {
+            return this->name(doc) < key;
+        });
+
+    if (it == end || this->name(*it) != name || it->hash != hash) {
+        return NoCachedDocument;
+    }
+    return it - m_docs;
+}
+
+template <typename ToID>
+ir::NormalizedDocument ir::DocumentCache::document_with(size_t index,
+                                                        ToID to_id) const {
+    assert(index < m_n_docs);
+    const DocumentRecord& record = m_docs[index];
+
+    NormalizedDocument result;
+    auto& term_counts = result.sentence_term_counts;
+    term_counts.reserve(record.n_sentences, record.n_entries);
+
+    // the entries of all sentences follow their sizes
+    const std::uint32_t* sizes = m_data_words + record.data_offset;
+    const std::uint32_t* entry = sizes + record.n_sentences;
+
+    // terms and counts of the current sentence; reused for every sentence
+    std::vector<std::pair<term_id, size_t>> entries;
+    for (size_t s = 0; s < record.n_sentences; ++s) {
+        entries.clear();
+        for (size_t e = 0; e < sizes[s]; ++e, entry += 2) {
+            entries.emplace_back(to_id(entry[0]), entry[1]);
+        }
+
+        // rows are sorted by the IDs of the given vocabulary
+        std::sort(entries.begin(), entries.end());
+        for (const auto& entry : entries) {
+            term_counts.push_back(entry.first, entry.second);
+        }
+        term_counts.end_row();
+    }
+
+    return result;
+}
+
+ir::NormalizedDocument ir::DocumentCache::document(size_t index,
+                                                   Vocabulary& vocab) const {
+    std::string str;
+    return document_with(index, [this, &vocab, &str](std::uint32_t cache_id) {
+        str.assign(term(cache_id));
+        return vocab.intern(str);
+    });
+}
+
+ir::NormalizedDocument
+ir::DocumentCache::document(size_t index, Vocabulary& vocab,
+                            std::vector<term_id>& term_ids,
+                            size_t n_shared) const {
+    term_ids.resize(m_n_terms, InvalidTermID);
+    std::string str;
+    return document_with(index, [this, &vocab, &term_ids, &str,
+                                 n_shared](std::uint32_t cache_id) {
+        if (term_ids[cache_id] != InvalidTermID) {
+            return term_ids[cache_id];
+        }
+        str.assign(term(cache_id));
+        const term_id id = vocab.intern(str);
+        if (id < n_shared) {
+            term_ids[cache_id] = id;
+        }
+        return id;
+    });
+}
+
+ir::DocumentCacheWriter::DocumentCacheWriter(std::ostream& os) : m_os(os) {
+    // the header is written by finish()
+    const char placeholder[sizeof(CacheHeader)] = {};
+    static_assert(sizeof(CacheHeader) % 8 == 0,
+                  "The document data must be 8 byte aligned");
+    m_os.write(placeholder, sizeof(placeholder));
+}
+
+void ir::DocumentCacheWriter::add(std::string_view name, std::uint64_t hash,
+                                  const NormalizedDocument& doc,
+                                  const Vocabulary& vocab,
+                                  std::vector<term_id>& term_ids) {
+    const auto& term_counts = doc.sentence_term_counts;
+    term_ids.resize(vocab.size(), InvalidTermID);
+
+    m_block.clear();
+    for (size_t row = 0; row < term_counts.rows(); ++row) {
+        m_block.push_back(
+            static_cast<std::uint32_t>(term_counts.row(row).size()));
+    }
+    for (size_t row = 0; row < term_counts.rows(); ++row) {
+        const auto terms = term_counts.row(row);
+        for (size_t k = 0; k < terms.size(); ++k) {
+            term_id& cache_id = term_ids[terms.term(k)];
+            if (cache_id == InvalidTermID) {
+                cache_id = m_vocab.intern(vocab.term(terms.term(k)));
+            }
+            m_block.push_back(cache_id);
+            m_block.push_back(static_cast<std::uint32_t>(terms.value(k)));
+        }
+    }
+    m_os.write(reinterpret_cast<const char*>(m_block.data()),
+               m_block.size() * sizeof(std::uint32_t));
+
+    m_records.push_back({hash, m_names.size(), name.size(), m_data_size,
+                         term_counts.rows(), term_counts.entries()});
+    m_names.append(name);
+    m_data_size += m_block.size();
+}
+
+/**
+ * @brief Write zero bytes to the given output stream up to the next offset
+ * that is a multiple of 8, given the number of bytes written so far.
+ */
+static void pad8(std::ostream& os, size_t n_bytes) {
+    const char zeros[8] = {};
+    os.write(zeros, align8(n_bytes) - n_bytes);
+}
+
+std::ostream& ir::DocumentCacheWriter::finish() {
+    pad8(m_os, m_data_size * sizeof(std::uint32_t));
+
+    // document names follow the terms in the string pool
+    std::uint64_t pool_size = 0;
+    std::vector<std::uint64_t> term_offsets(m_vocab.size() + 1, 0);
+    for (term_id id = 0; id < m_vocab.size(); ++id) {
+        pool_size += m_vocab.term(id).size();
+        term_offsets[id + 1] = pool_size;
+    }
+
+    // records are sorted by name for binary search
+    const auto name = [this](const DocumentRecord& record) {
+        return std::string_view(m_names).substr(record.name_offset,
+                                                record.name_size);
+    };
+    std::sort(m_records.begin(), m_records.end(),
+              [&name](const DocumentRecord& left,
+                      const DocumentRecord& right) {
+                  return name(left) < name(right);
+              });
+    for (DocumentRecord record : m_records) {
+        record.name_offset += pool_size;
+        m_os.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    pad8(m_os, m_records.size() * sizeof(DocumentRecord));
+
+    m_os.write(reinterpret_cast<const char*>(term_offsets.data()),
+               term_offsets.size() * sizeof(std::uint64_t));
+    pad8(m_os, term_offsets.size() * sizeof(std::uint64_t));
+    for (term_id id = 0; id < m_vocab.size(); ++id) {
+        const std::string term = m_vocab.term(id);
+        m_os.write(term.data(), term.size());
+    }
+    m_os.write(m_names.data(), m_names.size());
+    pad8(m_os, pool_size + m_names.size());
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = DocumentCacheVersion;
+    header.stopwords = stopwords_fingerprint();
+    header.n_docs = m_records.size();
+    header.n_terms = m_vocab.size();
+    header.data_size = m_data_size;
+    header.pool_size = pool_size + m_names.size();
+    m_os.seekp(0);
+    m_os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_os << std::flush;
+
+    return m_os;
+}
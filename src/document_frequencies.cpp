@@ -0,0 +1,381 @@
+#include "document_frequencies.hpp"
+#include "file_manager.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include "tokenizer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Marker of a term that hasn't been counted for any document yet.
+ */
+static const size_t NoDoc = std::numeric_limits<size_t>::max();
+
+ir::DocumentFrequencies::DocumentFrequencies(const IdfModel& model) {
+    if (not model.has_counts()) {
+        throw std::runtime_error(
+            "idf model doesn't store document frequencies");
+    }
+    if (model.pruned()) {
+        throw std::runtime_error("idf model is pruned");
+    }
+
+    m_df.resize(model.size());
+    for (term_id id = 0; id < model.size(); ++id) {
+        m_vocab.intern(model.term(id));
+        m_df[id] = model.df(id);
+    }
+    m_last_doc.assign(m_df.size(), NoDoc);
+    m_n_docs = model.n_docs();
+}
+
+ir::DocumentFrequencies::DocumentFrequencies(
+    const std::vector<std::string>& terms,
+    const std::vector<size_t>& doc_freqs, size_t n_docs, bool pruned,
+    size_t missing_df)
+    : m_df(doc_freqs), m_last_doc(doc_freqs.size(), NoDoc), m_n_docs(n_docs),
+      m_pruned(pruned), m_missing_df(missing_df) {
+    assert(terms.size() == doc_freqs.size());
+    for (const auto& term : terms) {
+        m_vocab.intern(term);
+    }
+    assert(m_vocab.size() == terms.size() && "Terms must be distinct");
+}
+
+ir::DocumentFrequencies::DocumentFrequencies(
+    const std::vector<IdfModel>& models) {
+    // position of the merge in a model: its next term and the ID of the term
+    struct Cursor {
+        std::string term;
+        term_id id;
+        size_t model;
+    };
+    const auto greater = [](const Cursor& left, const Cursor& right) {
+        return left.term > right.term;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(
+        greater);
+
+    for (size_t m = 0; m < models.size(); ++m) {
+        if (not models[m].has_counts()) {
+            throw std::runtime_error(
+                "idf model doesn't store document frequencies");
+        }
+        if (models[m].pruned()) {
+            throw std::runtime_error("idf model is pruned");
+        }
+        m_n_docs += models[m].n_docs();
+        if (models[m].size() != 0) {
+            heap.push({models[m].term(0), 0, m});
+        }
+    }
+
+    // pop terms in lexicographical order; equal terms of different models
+    // are popped consecutively and their counts are summed
+    std::string last_term;
+    while (not heap.empty()) {
+        Cursor cursor = heap.top();
+        heap.pop();
+
+        const IdfModel& model = models[cursor.model];
+        if (m_df.empty() || cursor.term != last_term) {
+            m_vocab.intern(cursor.term);
+            m_df.push_back(0);
+            last_term = cursor.term;
+        }
+        m_df.back() += model.df(cursor.id);
+
+        if (++cursor.id < model.size()) {
+            std::string next_term = model.term(cursor.id);
+            if (next_term <= cursor.term) {
+                throw std::runtime_error("Terms of idf model aren't sorted");
+            }
+            cursor.term = std::move(next_term);
+            heap.push(std::move(cursor));
+        }
+    }
+
+    m_last_doc.assign(m_df.size(), NoDoc);
+}
+
+ir::DocumentFrequencies::DocumentFrequencies(
+    const IdfModel& model, const DocumentFrequencies& batch, bool remove)
+    : m_n_docs(model.n_docs()) {
+    if (not model.has_counts()) {
+        throw std::runtime_error(
+            "idf model doesn't store document frequencies");
+    }
+    if (model.pruned()) {
+        throw std::runtime_error("idf model is pruned");
+    }
+    if (remove && batch.m_n_docs > m_n_docs) {
+        throw std::invalid_argument(
+            "Removing more documents than counted in the idf model");
+    }
+
+    // merge the two sorted term sequences; terms whose count becomes 0 are
+    // dropped as in sort_terms
+    std::string model_term, batch_term;
+    size_t i = 0, j = 0;
+    if (model.size() != 0) {
+        model_term = model.term(0);
+    }
+    if (batch.m_df.size() != 0) {
+        batch_term = batch.m_vocab.term(0);
+    }
+    while (i < model.size() || j < batch.m_df.size()) {
+        const bool from_model =
+            i < model.size() &&
+            (j == batch.m_df.size() || model_term <= batch_term);
+        const bool from_batch =
+            j < batch.m_df.size() &&
+            (i == model.size() || batch_term <= model_term);
+
+        size_t doc_freq = from_model ? model.df(i) : 0;
+        if (from_batch && not remove) {
+            doc_freq += batch.m_df[j];
+        } else if (from_batch) {
+            if (doc_freq < batch.m_df[j]) {
+                throw std::invalid_argument(
+                    "Removing a term that isn't counted in the idf model");
+            }
+            doc_freq -= batch.m_df[j];
+        }
+        if (doc_freq != 0) {
+            m_vocab.intern(from_model ? model_term : batch_term);
+            m_df.push_back(doc_freq);
+        }
+
+        if (from_model && ++i < model.size()) {
+            std::string next_term = model.term(i);
+            if (next_term <= model_term) {
+                throw std::runtime_error("Terms of idf model aren't sorted");
+            }
+            model_term = std::move(next_term);
+        }
+        if (from_batch && ++j < batch.m_df.size()) {
+            std::string next_term = batch.m_vocab.term(j);
+            assert(batch_term < next_term && "Terms must be sorted");
+            batch_term = std::move(next_term);
+        }
+    }
+
+    m_n_docs = remove ? m_n_docs - batch.m_n_docs : m_n_docs + batch.m_n_docs;
+    m_pruned = batch.m_pruned;
+    m_missing_df = batch.m_missing_df;
+    m_last_doc.assign(m_df.size(), NoDoc);
+}
+
+void ir::DocumentFrequencies::add(const NormalizedDocument& doc) {
+    m_df.resize(m_vocab.size(), 0);
+    m_last_doc.resize(m_vocab.size(), NoDoc);
+
+    // increment count of each occurring word once
+    for (const term_id word : doc.sentence_term_counts.terms()) {
+        if (m_last_doc[word] != m_n_docs) {
+            m_last_doc[word] = m_n_docs;
+            ++m_df[word];
+        }
+    }
+
+    ++m_n_docs;
+}
+
+void ir::DocumentFrequencies::merge(const DocumentFrequencies& other) {
+    for (term_id id = 0; id < other.m_df.size(); ++id) {
+        const term_id own_id = m_vocab.intern(other.m_vocab.term(id));
+        if (own_id >= m_df.size()) {
+            m_df.resize(own_id + 1, 0);
+        }
+        m_df[own_id] += other.m_df[id];
+    }
+
+    m_n_docs += other.m_n_docs;
+    m_pruned = m_pruned || other.m_pruned;
+    m_missing_df += other.m_missing_df;
+    m_last_doc.assign(m_df.size(), NoDoc);
+}
+
+void ir::DocumentFrequencies::sort_terms() {
+    // terms that occur in no document are dropped
+    std::vector<std::string> terms(m_df.size());
+    std::vector<term_id> order;
+    order.reserve(terms.size());
+    for (term_id id = 0; id < terms.size(); ++id) {
+        terms[id] = m_vocab.term(id);
+        if (m_df[id] != 0) {
+            order.push_back(id);
+        }
+    }
+
+    std::sort(order.begin(), order.end(),
+              [&terms](term_id left, term_id right) {
+                  return terms[left] < terms[right];
+              });
+
+    // intern terms in sorted order so that new IDs follow it
+    Vocabulary sorted_vocab;
+    std::vector<size_t> sorted_df(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted_vocab.intern(terms[order[i]]);
+        sorted_df[i] = m_df[order[i]];
+    }
+
+    m_vocab = std::move(sorted_vocab);
+    m_df = std::move(sorted_df);
+    m_last_doc.assign(m_df.size(), NoDoc);
+}
+
+void ir::DocumentFrequencies::prune(size_t min_df, double max_df_ratio) {
+    const double max_df = max_df_ratio * m_n_docs;
+
+    // sort_terms drops the terms whose count is 0; too common terms keep
+    // their counts so that they can be told apart from missing rare terms
+    for (size_t& doc_freq : m_df) {
+        if (doc_freq != 0 && doc_freq < min_df) {
+            m_missing_df = std::max(m_missing_df, doc_freq);
+            doc_freq = 0;
+            m_pruned = true;
+        } else if (doc_freq > max_df &&
+                   (m_common_df == 0 || doc_freq < m_common_df)) {
+            m_common_df = doc_freq;
+            m_pruned = true;
+        }
+    }
+    sort_terms();
+}
+
+std::vector<double> ir::DocumentFrequencies::idf_scores() const {
+    std::vector<double> result(m_df.size());
+    for (size_t i = 0; i < m_df.size(); ++i) {
+        double doc_freq = m_df[i];
+        const bool common = m_common_df != 0 && m_df[i] >= m_common_df;
+        result[i] = common ? 0 : std::log10(m_n_docs / doc_freq);
+    }
+
+    return result;
+}
+
+ir::DocumentFrequencies
+ir::corpus_document_frequencies(const std::vector<std::string>& file_list,
+                                size_t n_threads, CorpusCache* corpus_cache,
+                                TermCacheStats* term_stats) {
+    ThreadPool pool(n_threads);
+    const size_t n_slices = std::min(pool.size(), file_list.size());
+
+    const DocumentCache* cache = corpus_cache ? corpus_cache->cache : nullptr;
+    DocumentCacheWriter* writer =
+        corpus_cache ? corpus_cache->writer : nullptr;
+    // the writer is shared by all slices
+    std::mutex writer_mutex;
+    std::vector<size_t> hits(n_slices, 0);
+    std::vector<TermCacheStats> slice_term_stats(n_slices);
+    // first file of each slice that couldn't be read; empty if none
+    std::vector<std::string> unreadable(n_slices);
+
+    // process each contiguous slice of the file list in a separate task
+    std::vector<DocumentFrequencies> partials(n_slices);
+    for (size_t t = 0; t < n_slices; ++t) {
+        const size_t begin = file_list.size() * t / n_slices;
+        const size_t end = file_list.size() * (t + 1) / n_slices;
+
+        pool.submit([&file_list, &partials, &writer_mutex, &hits,
+                     &slice_term_stats, &unreadable, cache, writer, t, begin,
+                     end] {
+            auto& partial = partials[t];
+            TermCache term_cache;
+            std::string contents;
+            std::vector<term_id> cache_ids;
+            std::vector<term_id> writer_ids;
+
+            // parse, normalize and count one document at a time so that only
+            // the vocabulary and the counts are kept in memory
+            for (size_t i = begin; i < end; ++i) {
+                const std::string name = doc_name_from_filepath(file_list[i]);
+                std::uint64_t hash = 0;
+                size_t index = NoCachedDocument;
+                NormalizedDocument doc;
+                if (cache || writer) {
+                    // the contents are needed to look the document up
+                    if (not read_file(file_list[i], contents)) {
+                        unreadable[t] = file_list[i];
+                        return;
+                    }
+
+                    hash = content_hash(contents);
+                    index = cache ? cache->find(name, hash) : NoCachedDocument;
+                }
+
+                if (index != NoCachedDocument) {
+                    doc = cache->document(index, partial.vocab(), cache_ids);
+                    ++hits[t];
+                } else if (cache || writer) {
+                    std::istringstream iss(contents);
+                    const RawDocument raw_doc = parse_doc_file(iss);
+                    doc = normalize_document(raw_doc, partial.vocab(),
+                                             term_cache);
+                } else {
+                    std::ifstream ifs(file_list[i]);
+                    if (not ifs) {
+                        unreadable[t] = file_list[i];
+                        return;
+                    }
+                    const RawDocument raw_doc = parse_doc_file(ifs);
+                    if (ifs.bad()) {
+                        unreadable[t] = file_list[i];
+                        return;
+                    }
+                    doc = normalize_document(raw_doc, partial.vocab(),
+                                             term_cache);
+                }
+                partial.add(doc);
+
+                if (writer) {
+                    std::lock_guard<std::mutex> lock(writer_mutex);
+                    writer->add(name, hash, doc, partial.vocab(), writer_ids);
+                }
+            }
+            slice_term_stats[t].add(term_cache);
+        });
+    }
+    pool.wait();
+
+    // an unreadable document would be counted as an empty one
+    for (const std::string& path : unreadable) {
+        if (not path.empty()) {
+            throw std::runtime_error("Couldn't read " + path);
+        }
+    }
+
+    DocumentFrequencies result;
+    for (const auto& partial : partials) {
+        result.merge(partial);
+    }
+    result.sort_terms();
+
+    if (term_stats != nullptr) {
+        for (const auto& slice_stats : slice_term_stats) {
+            term_stats->add(slice_stats);
+        }
+    }
+    if (corpus_cache == nullptr) {
+        return result;
+    }
+    for (const size_t slice_hits : hits) {
+        corpus_cache->hits += slice_hits;
+    }
+    const size_t cache_size = cache ? cache->size() : 0;
+    corpus_cache->stale = corpus_cache->hits != file_list.size() ||
+                          cache_size != file_list.size();
+
+    return result;
+}
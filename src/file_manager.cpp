@@ -4,6 +4,7 @@
 #include <dirent.h>
 #include <fstream>
 #include <iomanip>
+#include <limits>
 #include <numeric>
 #include <sstream>
 
@@ -31,6 +32,23 @@ ir::get_data_file_list(const std::string& dataset_dir) {
     return file_list;
 }
 
+bool ir::read_file(const std::string& filepath, std::string& contents) {
+    std::ifstream ifs(filepath, std::ios::binary);
+    if (not ifs) {
+        return false;
+    }
+
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    contents = oss.str();
+
+    return not ifs.bad();
+}
+
+std::string ir::doc_name_from_filepath(const std::string& filepath) {
+    return filepath.substr(filepath.rfind('/') + 1);
+}
+
 size_t ir::doc_id_from_filepath(const std::string& filepath) {
     size_t last_slash_index = filepath.rfind('/');
     size_t next_dot_inedx = filepath.find('.', last_slash_index);
@@ -41,14 +59,14 @@ size_t ir::doc_id_from_filepath(const std::string& filepath) {
     return std::stoul(id_str);
 }
 
-std::ostream&
-ir::write_idf_file(std::ostream& os,
-                   const std::unordered_map<std::string, double>& idf_scores) {
+std::ostream& ir::write_idf_file(std::ostream& os, const Vocabulary& vocab,
+                                 const std::vector<double>& idf_scores) {
+    assert(vocab.size() == idf_scores.size());
     double precision = std::numeric_limits<double>::max_digits10;
 
-    for (const auto& term_pair : idf_scores) {
-        const auto& term = term_pair.first;
-        const double idf = term_pair.second;
+    for (term_id id = 0; id < vocab.size(); ++id) {
+        const auto& term = vocab.term(id);
+        const double idf = idf_scores[id];
 
         os << term << ' ' << std::setprecision(precision) << idf << '\n';
     }
@@ -57,16 +75,32 @@ ir::write_idf_file(std::ostream& os,
     return os;
 }
 
-std::istream&
-ir::read_idf_file(std::istream& is,
-                  std::unordered_map<std::string, double>& idf_scores) {
+std::istream& ir::read_idf_file(std::istream& is, Vocabulary& vocab,
+                                std::vector<double>& idf_scores) {
+    assert(vocab.size() == 0 && "Vocabulary must be empty in ir::read_idf_file");
+
     std::string term;
     double idf;
     while (is >> term >> idf) {
-        assert(idf_scores.find(term) == idf_scores.end() &&
+        assert(vocab.find(term) == InvalidTermID &&
                "Term already exists in ir::read_idf_file");
-        idf_scores[term] = idf;
+        vocab.intern(term);
+        idf_scores.push_back(idf);
     }
 
     return is;
 }
+
+ir::IdfModel ir::load_idf_model() {
+    // binary model can be mapped without parsing
+    if (std::ifstream(IDF_MODEL_FILEPATH)) {
+        return IdfModel(IDF_MODEL_FILEPATH);
+    }
+
+    Vocabulary vocab;
+    std::vector<double> idf_scores;
+    std::ifstream idf_file(IDF_FILEPATH);
+    read_idf_file(idf_file, vocab, idf_scores);
+
+    return IdfModel(vocab, idf_scores);
+}
@@ -0,0 +1,413 @@
+#include "idf_model.hpp"
+#include "vocabulary.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * @brief Magic bytes at the beginning of every binary idf model.
+ */
+static const char ModelMagic[8] = {'L', 'X', 'R', 'K', 'I', 'D', 'F', '\0'};
+
+/**
+ * @brief Flag of models from which terms of the corpus are missing.
+ */
+static const std::uint64_t PrunedModelFlag = 1;
+
+/**
+ * @brief Flag of models storing document frequencies instead of idf scores.
+ */
+static const std::uint64_t CountsModelFlag = 2;
+
+/**
+ * @brief Header of the binary idf model format.
+ */
+struct ModelHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t n_terms;
+    std::uint64_t n_slots;
+    std::uint64_t pool_size;
+    std::uint64_t n_docs;
+    std::uint64_t flags;
+    std::uint64_t missing_df;
+    std::uint64_t common_df;
+};
+
+/**
+ * @brief Round the given byte count up to a multiple of 8.
+ */
+static size_t align8(size_t n_bytes) { return (n_bytes + 7) & ~size_t(7); }
+
+/**
+ * @brief 64-bit FNV-1a hash of the given byte sequence.
+ */
+static std::uint64_t hash_term(const char* str, size_t len) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Byte offsets of each section of a model image.
+ */
+struct SectionOffsets {
+    size_t weights;
+    size_t offsets;
+    size_t slots;
+    size_t strings;
+    size_t end;
+};
+
+/**
+ * @brief Compute the section offsets of a model with the given header.
+ */
+static SectionOffsets section_offsets(const ModelHeader& header) {
+    SectionOffsets result;
+    result.weights = align8(sizeof(ModelHeader));
+    result.offsets =
+        result.weights + align8(header.n_terms * sizeof(std::uint64_t));
+    result.slots = result.offsets +
+                   align8((header.n_terms + 1) * sizeof(std::uint64_t));
+    result.strings =
+        result.slots + align8(header.n_slots * sizeof(ir::term_id));
+    result.end = result.strings + align8(header.pool_size);
+    return result;
+}
+
+/**
+ * @brief Build the binary model image of the given vocabulary and term
+ * weights.
+ *
+ * @param vocab Vocabulary containing the terms.
+ * @param weights 8-byte weight of each term at the index of its term ID;
+ * document frequencies if flags has CountsModelFlag, idf scores otherwise.
+ * @param n_docs Number of documents in the corpus; 0 for idf scores.
+ * @param flags Model flags.
+ * @param missing_df Upper bound of the document frequency of the rare terms
+ * of the corpus missing from the model.
+ * @param common_df Minimum document frequency of the terms marked too common;
+ * 0 if no term is marked.
+ * @return Image stored as 8-byte words.
+ */
+static std::vector<std::uint64_t> build_image(const ir::Vocabulary& vocab,
+                                              const void* weights,
+                                              size_t n_docs,
+                                              std::uint64_t flags,
+                                              size_t missing_df,
+                                              size_t common_df) {
+    const size_t n_terms = vocab.size();
+
+    ModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, ModelMagic, sizeof(ModelMagic));
+    header.version = ir::IdfModelVersion;
+    header.n_terms = static_cast<std::uint32_t>(n_terms);
+    header.n_docs = n_docs;
+    header.flags = flags;
+    header.missing_df = missing_df;
+    header.common_df = common_df;
+
+    // at most half of the slots are occupied
+    header.n_slots = 1;
+    while (header.n_slots < 2 * n_terms) {
+        header.n_slots *= 2;
+    }
+
+    header.pool_size = 0;
+    for (ir::term_id id = 0; id < n_terms; ++id) {
+        header.pool_size += vocab.term(id).size();
+    }
+
+    const SectionOffsets sections = section_offsets(header);
+    std::vector<std::uint64_t> image(sections.end / sizeof(std::uint64_t), 0);
+    char* data = reinterpret_cast<char*>(image.data());
+
+    std::memcpy(data, &header, sizeof(header));
+    std::memcpy(data + sections.weights, weights,
+                n_terms * sizeof(std::uint64_t));
+
+    auto* offsets = reinterpret_cast<std::uint64_t*>(data + sections.offsets);
+    auto* slots = reinterpret_cast<ir::term_id*>(data + sections.slots);
+    char* strings = data + sections.strings;
+    std::fill(slots, slots + header.n_slots, ir::InvalidTermID);
+
+    const size_t slot_mask = header.n_slots - 1;
+    std::uint64_t offset = 0;
+    for (ir::term_id id = 0; id < n_terms; ++id) {
+        const std::string term = vocab.term(id);
+        offsets[id] = offset;
+        std::memcpy(strings + offset, term.data(), term.size());
+        offset += term.size();
+
+        size_t slot = hash_term(term.data(), term.size()) & slot_mask;
+        while (slots[slot] != ir::InvalidTermID) {
+            slot = (slot + 1) & slot_mask;
+        }
+        slots[slot] = id;
+    }
+    offsets[n_terms] = offset;
+
+    return image;
+}
+
+/**
+ * @brief Build the binary model image of the given vocabulary and idf scores.
+ */
+static std::vector<std::uint64_t>
+build_image(const ir::Vocabulary& vocab,
+            const std::vector<double>& idf_scores) {
+    assert(vocab.size() == idf_scores.size());
+    return build_image(vocab, idf_scores.data(), 0, 0, 0, 0);
+}
+
+/**
+ * @brief Build the binary model image of the given vocabulary and document
+ * frequencies.
+ */
+static std::vector<std::uint64_t>
+build_image(const ir::Vocabulary& vocab, const std::vector<size_t>& doc_freqs,
+            size_t n_docs, bool pruned, size_t missing_df, size_t common_df) {
+    assert(vocab.size() == doc_freqs.size());
+    assert((n_docs > 0 || doc_freqs.empty()) &&
+           "Counted terms must occur in a document");
+
+    const std::vector<std::uint64_t> counts(doc_freqs.begin(),
+                                            doc_freqs.end());
+    assert(std::find(counts.begin(), counts.end(), 0) == counts.end());
+    return build_image(vocab, counts.data(), n_docs,
+                       CountsModelFlag | (pruned ? PrunedModelFlag : 0),
+                       missing_df, common_df);
+}
+
+ir::IdfModel::IdfModel(const std::string& filepath) {
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Couldn't open idf model " + filepath);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(ModelHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Invalid idf model " + filepath);
+    }
+
+    const size_t n_bytes = static_cast<size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, n_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Couldn't map idf model " + filepath);
+    }
+
+    m_data = static_cast<const char*>(addr);
+    m_mapped_size = n_bytes;
+    try {
+        init_sections(n_bytes);
+    } catch (...) {
+        ::munmap(addr, n_bytes);
+        throw;
+    }
+}
+
+ir::IdfModel::IdfModel(const Vocabulary& vocab,
+                       const std::vector<double>& idf_scores)
+    : m_owned(build_image(vocab, idf_scores)) {
+    m_data = reinterpret_cast<const char*>(m_owned.data());
+    init_sections(m_owned.size() * sizeof(std::uint64_t));
+}
+
+ir::IdfModel::IdfModel(const Vocabulary& vocab,
+                       const std::vector<size_t>& doc_freqs, size_t n_docs,
+                       bool pruned, size_t missing_df, size_t common_df)
+    : m_owned(build_image(vocab, doc_freqs, n_docs, pruned, missing_df,
+                          common_df)) {
+    m_data = reinterpret_cast<const char*>(m_owned.data());
+    init_sections(m_owned.size() * sizeof(std::uint64_t));
+}
+
+ir::IdfModel::IdfModel(IdfModel&& other) noexcept { *this = std::move(other); }
+
+ir::IdfModel& ir::IdfModel::operator=(IdfModel&& other) noexcept {
+    if (this != &other) {
+        if (m_mapped_size != 0) {
+            ::munmap(const_cast<char*>(m_data), m_mapped_size);
+        }
+
+        m_data = other.m_data;
+        m_mapped_size = other.m_mapped_size;
+        m_owned = std::move(other.m_owned);
+        m_n_terms = other.m_n_terms;
+        m_slot_mask = other.m_slot_mask;
+        m_n_docs = other.m_n_docs;
+        m_has_counts = other.m_has_counts;
+        m_pruned = other.m_pruned;
+        m_missing_df = other.m_missing_df;
+        m_common_df = other.m_common_df;
+        m_oov_idf = other.m_oov_idf;
+        m_idf = other.m_idf;
+        m_df = other.m_df;
+        m_offsets = other.m_offsets;
+        m_slots = other.m_slots;
+        m_strings = other.m_strings;
+        m_id_space = std::move(other.m_id_space);
+
+        other.m_data = nullptr;
+        other.m_mapped_size = 0;
+    }
+    return *this;
+}
+
+ir::IdfModel::~IdfModel() {
+    if (m_mapped_size != 0) {
+        ::munmap(const_cast<char*>(m_data), m_mapped_size);
+    }
+}
+
+void ir::IdfModel::init_sections(size_t n_bytes) {
+    ModelHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+
+    if (std::memcmp(header.magic, ModelMagic, sizeof(ModelMagic)) != 0 ||
+        header.version != IdfModelVersion) {
+        throw std::runtime_error("Unsupported idf model format");
+    }
+
+    // section sizes are bounded by the file size first, so that computing
+    // the section offsets can't overflow
+    if (header.n_terms > n_bytes || header.n_slots > n_bytes ||
+        header.pool_size > n_bytes) {
+        throw std::runtime_error("Corrupt idf model");
+    }
+    const SectionOffsets sections = section_offsets(header);
+    if (sections.end > n_bytes || header.n_slots == 0 ||
+        (header.n_slots & (header.n_slots - 1)) != 0) {
+        throw std::runtime_error("Corrupt idf model");
+    }
+
+    // find() and term() index the string pool by the term offsets and stop
+    // probing at an empty slot, so a corrupt file must not reach them
+    const auto* offsets =
+        reinterpret_cast<const std::uint64_t*>(m_data + sections.offsets);
+    if (offsets[0] != 0 || offsets[header.n_terms] > header.pool_size ||
+        not std::is_sorted(offsets, offsets + header.n_terms + 1)) {
+        throw std::runtime_error("Corrupt idf model term offsets");
+    }
+    const auto* slots =
+        reinterpret_cast<const term_id*>(m_data + sections.slots);
+    size_t n_empty = 0;
+    for (size_t slot = 0; slot < header.n_slots; ++slot) {
+        if (slots[slot] == InvalidTermID) {
+            ++n_empty;
+        } else if (slots[slot] >= header.n_terms) {
+            throw std::runtime_error("Corrupt idf model hash table");
+        }
+    }
+    if (n_empty == 0) {
+        throw std::runtime_error("Corrupt idf model hash table");
+    }
+
+    m_n_terms = header.n_terms;
+    m_slot_mask = header.n_slots - 1;
+    m_n_docs = header.n_docs;
+    m_has_counts = (header.flags & CountsModelFlag) != 0;
+    m_pruned = (header.flags & PrunedModelFlag) != 0;
+    m_missing_df = header.missing_df;
+    m_common_df = header.common_df;
+    if (not m_has_counts) {
+        m_idf = reinterpret_cast<const double*>(m_data + sections.weights);
+        m_df = nullptr;
+        // only models built from text idf files lack counts
+        m_oov_idf = m_n_terms == 0
+                        ? 0
+                        : *std::max_element(m_idf, m_idf + m_n_terms);
+    } else {
+        m_idf = nullptr;
+        m_df =
+            reinterpret_cast<const std::uint64_t*>(m_data + sections.weights);
+        // idf of the most frequent term that can be missing; a term missing
+        // from an unpruned model occurs in no document, like a new one
+        const double missing_df = std::max<std::uint64_t>(m_missing_df, 1);
+        m_oov_idf = m_n_docs == 0 ? 0 : std::log10(m_n_docs / missing_df);
+    }
+    m_offsets = offsets;
+    m_slots = slots;
+    m_strings = m_data + sections.strings;
+}
+
+ir::term_id ir::IdfModel::find(const std::string& term) const {
+    size_t slot = hash_term(term.data(), term.size()) & m_slot_mask;
+
+    // linear probing until the term or an empty slot is found
+    for (term_id id = m_slots[slot]; id != InvalidTermID;
+         id = m_slots[slot]) {
+        const size_t len = m_offsets[id + 1] - m_offsets[id];
+        if (len == term.size() &&
+            std::memcmp(m_strings + m_offsets[id], term.data(), len) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & m_slot_mask;
+    }
+
+    return InvalidTermID;
+}
+
+std::string ir::IdfModel::term(term_id id) const {
+    assert(id < m_n_terms);
+    return std::string(m_strings + m_offsets[id],
+                       m_offsets[id + 1] - m_offsets[id]);
+}
+
+double ir::IdfModel::idf(term_id id) const {
+    if (id >= m_n_terms) {
+        throw std::out_of_range("Term has no idf score in ir::IdfModel::idf");
+    }
+    if (m_df == nullptr) {
+        return m_idf[id];
+    }
+
+    // same expression as ir::DocumentFrequencies::idf_scores
+    if (m_common_df != 0 && m_df[id] >= m_common_df) {
+        return 0;
+    }
+    double doc_freq = m_df[id];
+    return std::log10(m_n_docs / doc_freq);
+}
+
+size_t ir::IdfModel::df(term_id id) const {
+    assert(id < m_n_terms && m_df != nullptr);
+    return static_cast<size_t>(m_df[id]);
+}
+
+std::ostream& ir::write_idf_model(std::ostream& os, const Vocabulary& vocab,
+                                  const std::vector<double>& idf_scores) {
+    const auto image = build_image(vocab, idf_scores);
+    os.write(reinterpret_cast<const char*>(image.data()),
+             image.size() * sizeof(std::uint64_t));
+    os << std::flush;
+
+    return os;
+}
+
+std::ostream& ir::write_idf_model(std::ostream& os, const Vocabulary& vocab,
+                                  const std::vector<size_t>& doc_freqs,
+                                  size_t n_docs, bool pruned,
+                                  size_t missing_df, size_t common_df) {
+    const auto image =
+        build_image(vocab, doc_freqs, n_docs, pruned, missing_df, common_df);
+    os.write(reinterpret_cast<const char*>(image.data()),
+             image.size() * sizeof(std::uint64_t));
+    os << std::flush;
+
+    return os;
+}
@@ -1,33 +1,120 @@
 #include "lexrank.hpp"
-
-ir::Matrix<char> ir::build_adjacency_matrix(
-    const std::vector<std::unordered_map<std::string, double>>& tfidf_maps) {
-    // resulting adjacency matrix
-    Matrix<char> result(tfidf_maps.size(), tfidf_maps.size());
-
-    // for each different pair
-    for (size_t i = 0; i < tfidf_maps.size(); ++i) {
-        for (size_t j = i + 1; j < tfidf_maps.size(); ++j) {
-            const auto& row_sentence = tfidf_maps[i];
-            const auto& col_sentence = tfidf_maps[j];
+#include <stdexcept>
+
+/**
+ * @brief Add an edge between every pair of sentences \f$(i, j)\f$ with
+ * \f$i < j\f$ in the given tile whose cosine similarity reaches
+ * ir::LexrankEdgeThreshold.
+ *
+ * @param tfidf_vecs tf-idf vector of each sentence, one per row.
+ * @param row_begin First row of the tile.
+ * @param row_end One past the last row of the tile.
+ * @param col_begin First column of the tile.
+ * @param col_end One past the last column of the tile.
+ * @param result Adjacency matrix to add the edges.
+ */
+static void compare_tile(const ir::SparseRows<double>& tfidf_vecs,
+                         size_t row_begin, size_t row_end, size_t col_begin,
+                         size_t col_end, ir::AdjacencyMatrix& result) {
+    for (size_t i = row_begin; i < row_end; ++i) {
+        const auto row_sentence = tfidf_vecs.row(i);
+        for (size_t j = std::max(col_begin, i + 1); j < col_end; ++j) {
+            const auto col_sentence = tfidf_vecs.row(j);
 
             // if cosine similarity is greater than threshold, make an edge
             double cos_sim = ir::cosine_sim(row_sentence, col_sentence);
-            if (cos_sim >= LexrankEdgeThreshold) {
-                result(i, j) = result(j, i) = 1;
+            if (cos_sim >= ir::LexrankEdgeThreshold) {
+                result.set(i, j);
             }
         }
     }
+}
+
+ir::AdjacencyMatrix
+ir::build_adjacency_matrix(const SparseRows<double>& tfidf_vecs,
+                           size_t n_threads) {
+    const size_t n = tfidf_vecs.rows();
+
+    // resulting adjacency matrix
+    AdjacencyMatrix result(n);
+
+    if (n_threads == 1 || n <= GraphTileSize) {
+        // for each different pair
+        compare_tile(tfidf_vecs, 0, n, 0, n, result);
+    } else {
+        const size_t n_tiles = (n + GraphTileSize - 1) / GraphTileSize;
+        ThreadPool pool(n_threads);
+        const auto submit_tile = [&](size_t tile_row, size_t tile_col) {
+            pool.submit([&tfidf_vecs, &result, n, tile_row, tile_col] {
+                compare_tile(tfidf_vecs, tile_row * GraphTileSize,
+                             std::min(n, (tile_row + 1) * GraphTileSize),
+                             tile_col * GraphTileSize,
+                             std::min(n, (tile_col + 1) * GraphTileSize),
+                             result);
+            });
+        };
+
+        // full tiles above the diagonal first, then the triangular ones
+        for (size_t tile_row = 0; tile_row < n_tiles; ++tile_row) {
+            for (size_t tile_col = tile_row + 1; tile_col < n_tiles;
+                 ++tile_col) {
+                submit_tile(tile_row, tile_col);
+            }
+        }
+        for (size_t tile = 0; tile < n_tiles; ++tile) {
+            submit_tile(tile, tile);
+        }
+        pool.wait();
+    }
+
+    // every node must have an edge to itself
+    for (size_t i = 0; i < result.rows(); ++i) {
+        result.set(i, i);
+    }
+
+    return result;
+}
+
+ir::AdjacencyMatrix
+ir::build_adjacency_matrix_indexed(const SparseRows<double>& tfidf_vecs) {
+    AdjacencyMatrix result = similarity_join(tfidf_vecs, LexrankEdgeThreshold);
+
+    // every node must have an edge to itself
+    for (size_t i = 0; i < result.rows(); ++i) {
+        result.set(i, i);
+    }
+
+    return result;
+}
+
+ir::AdjacencyMatrix
+ir::build_adjacency_matrix_approximate(const SparseRows<double>& tfidf_vecs,
+                                       const LshOptions& options,
+                                       LshStats* stats) {
+    AdjacencyMatrix result = approximate_similarity_join(
+        tfidf_vecs, LexrankEdgeThreshold, options, stats);
 
     // every node must have an edge to itself
     for (size_t i = 0; i < result.rows(); ++i) {
-        result(i, i) = true;
+        result.set(i, i);
     }
 
     return result;
 }
 
-ir::Matrix<double> ir::markov_chain_mat(const Matrix<char>& adj_mat,
+ir::GraphMethod ir::graph_method_from_name(const std::string& name) {
+    if (name == "exhaustive") {
+        return GraphMethod::Exhaustive;
+    } else if (name == "indexed") {
+        return GraphMethod::Indexed;
+    } else if (name == "lsh") {
+        return GraphMethod::Approximate;
+    }
+
+    throw std::invalid_argument("Unknown graph method " + name);
+}
+
+ir::Matrix<double> ir::markov_chain_mat(const AdjacencyMatrix& adj_mat,
                                         double damping_factor) {
     const size_t n = adj_mat.rows();
 
@@ -35,19 +122,13 @@ ir::Matrix<double> ir::markov_chain_mat(const Matrix<char>& adj_mat,
     Matrix<double> result(n, n);
     for (size_t j = 0; j < n; ++j) {
 
-        // calculate column sum
-        size_t colsum = 0;
-        for (size_t i = 0; i < n; ++i) {
-            colsum += adj_mat(i, j);
-        }
+        // column sum is the degree since the matrix is symmetric
+        const size_t colsum = adj_mat.degree(j);
 
         // uniform distribution initialization (random walk)
         double entry = 1.0 / colsum;
-        for (size_t i = 0; i < n; ++i) {
-            if (adj_mat(i, j)) {
-                result(i, j) = entry;
-            }
-        }
+        adj_mat.for_each_neighbor(
+            j, [&result, j, entry](size_t i) { result(i, j) = entry; });
     }
 
     // teleportation (damping)
@@ -62,43 +143,71 @@ ir::Matrix<double> ir::markov_chain_mat(const Matrix<char>& adj_mat,
     return result;
 }
 
-std::vector<double>
-ir::lexrank(const ir::NormalizedDocument& norm_doc,
-            const std::unordered_map<std::string, double>& idf_scores) {
-    // get tf-idf maps
-    auto tfidf_maps = ir::tf_idf_maps(norm_doc, idf_scores);
+ir::TransitionMatrix ir::markov_chain(const AdjacencyMatrix& adj_mat,
+                                     double damping_factor) {
+    const size_t n = adj_mat.rows();
 
-    // construct markov chain transition matrix
-    const Matrix<double> trans_mat =
-        markov_chain_mat(build_adjacency_matrix(tfidf_maps), DampingFactor);
+    // inverse degree of each node
+    std::vector<double> inv_degrees(n);
+    size_t n_edges = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t degree = adj_mat.degree(i);
+        inv_degrees[i] = 1.0 / degree;
+        n_edges += degree;
+    }
+
+    // row i stores the probability of moving from each neighbor j to i
+    SparseRows<double> links;
+    links.reserve(n, n_edges);
+    for (size_t i = 0; i < n; ++i) {
+        adj_mat.for_each_neighbor(i, [&links, &inv_degrees](size_t j) {
+            links.push_back(static_cast<term_id>(j), inv_degrees[j]);
+        });
+        links.end_row();
+    }
+
+    return TransitionMatrix(std::move(links), damping_factor);
+}
+
+std::vector<double> ir::lexrank(const ir::NormalizedDocument& norm_doc,
+                                const IdfModel& idf_model,
+                                const LexrankOptions& options,
+                                LexrankStats* stats) {
+    // get tf-idf vectors
+    const auto tfidf_vecs =
+        ir::tf_idf_vectors(norm_doc, idf_model, options.oov);
+
+    // build the sentence graph
+    LshStats lsh_stats;
+    AdjacencyMatrix adj_mat;
+    switch (options.graph) {
+    case GraphMethod::Exhaustive:
+        adj_mat = build_adjacency_matrix(tfidf_vecs, options.graph_threads);
+        break;
+    case GraphMethod::Approximate:
+        adj_mat = build_adjacency_matrix_approximate(tfidf_vecs, options.lsh,
+                                                     &lsh_stats);
+        break;
+    default:
+        adj_mat = build_adjacency_matrix_indexed(tfidf_vecs);
+    }
+
+    // construct sparse markov chain transition matrix
+    const TransitionMatrix trans_mat = markov_chain(adj_mat, DampingFactor);
 
     // initial distribution (assign uniform; doesn't matter anyways)
-    Vector<double> lexrank_dist(trans_mat.cols());
+    Vector<double> lexrank_dist(trans_mat.size());
     for (size_t i = 0; i < lexrank_dist.size(); ++i) {
         lexrank_dist(i) = 1.0 / lexrank_dist.size();
     }
 
-    // power iteration
-    Vector<double> prev = lexrank_dist;
-    while (true) {
-        // compute next distribution
-        lexrank_dist = trans_mat * lexrank_dist;
-
-        // if every entry is the same, we have converged
-        bool converged = true;
-        for (size_t i = 0; i < lexrank_dist.size(); ++i) {
-            if (not ir::close(lexrank_dist(i), prev(i),
-                              PowerIterationEpsilon)) {
-                converged = false;
-                break;
-            }
-        }
-
-        if (converged) {
-            break;
-        }
-
-        prev = lexrank_dist;
+    // stationary distribution
+    Vector<double> scratch(lexrank_dist.size());
+    const SolverStats solver_stats =
+        solve(trans_mat, lexrank_dist, scratch, options.solver);
+    if (stats != nullptr) {
+        stats->solver = solver_stats;
+        stats->lsh = lsh_stats;
     }
 
     // store results in a vector and return
@@ -1,24 +1,316 @@
+#include "approximate_frequencies.hpp"
+#include "document_frequencies.hpp"
 #include "file_manager.hpp"
-#include "lexrank.hpp"
 #include "parser.hpp"
+#include "summarizer.hpp"
 #include "tokenizer.hpp"
-#include "vector_space_model.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 #include <unordered_map>
 
+/**
+ * @brief Write a file at the given path using the given write function.
+ *
+ * The file is written to a temporary file first and then renamed, so that
+ * processes which have the old file mapped or which read the file
+ * concurrently never see a partially written file.
+ *
+ * @param path Path of the file.
+ * @param write Function writing the file to a binary std::ostream.
+ * @return true if the file is written successfully; false, otherwise.
+ */
+template <typename Write>
+static bool write_file_atomically(const std::string& path, Write write) {
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream ofs(tmp_path, std::ios::binary);
+        write(ofs);
+        if (not ofs) {
+            return false;
+        }
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * @brief Write the given counts in the binary idf model format to the given
+ * path (see write_file_atomically).
+ *
+ * @return true if the model is written successfully; false, otherwise.
+ */
+static bool write_model_file(const std::string& path,
+                             const ir::DocumentFrequencies& doc_freqs) {
+    return write_file_atomically(path, [&doc_freqs](std::ostream& os) {
+        ir::write_idf_model(os, doc_freqs.vocab(), doc_freqs.doc_freqs(),
+                            doc_freqs.n_docs(), doc_freqs.pruned(),
+                            doc_freqs.missing_df(), doc_freqs.common_df());
+    });
+}
+
+/**
+ * @brief Count the document frequencies of the given documents, reading the
+ * unchanged ones from the document cache at the given path, and replace the
+ * cache with the counted documents if they differ from the cached ones.
+ *
+ * The new cache is streamed to a temporary file while the documents are
+ * counted, and renamed to the given path at the end, as in
+ * write_file_atomically. An invalid cache is ignored and replaced.
+ *
+ * @param file_list List of document files.
+ * @param n_threads Number of threads to use.
+ * @param path Path to the document cache.
+ * @param term_stats Sums to add the counters of the token caches to.
+ * @return Document frequencies of the documents with sorted terms.
+ *
+ * @throw std::runtime_error if a document file can't be read or the cache
+ * can't be written.
+ */
+static ir::DocumentFrequencies
+cached_document_frequencies(const std::vector<std::string>& file_list,
+                            size_t n_threads, const std::string& path,
+                            ir::TermCacheStats& term_stats) {
+    ir::DocumentCache cache;
+    if (std::ifstream(path)) {
+        try {
+            cache = ir::DocumentCache(path);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ignoring " << path << ": " << e.what() << std::endl;
+        }
+    }
+
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream ofs(tmp_path, std::ios::binary);
+    ir::DocumentCacheWriter writer(ofs);
+    ir::CorpusCache corpus_cache;
+    corpus_cache.cache = &cache;
+    corpus_cache.writer = &writer;
+    ir::DocumentFrequencies doc_freqs;
+    try {
+        doc_freqs = ir::corpus_document_frequencies(
+            file_list, n_threads, &corpus_cache, &term_stats);
+    } catch (const std::runtime_error&) {
+        ofs.close();
+        std::remove(tmp_path.c_str());
+        throw;
+    }
+
+    // an up to date cache is kept
+    if (not corpus_cache.stale) {
+        ofs.close();
+        std::remove(tmp_path.c_str());
+        return doc_freqs;
+    }
+    writer.finish();
+    ofs.close();
+    if (not ofs || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Couldn't write " + path);
+    }
+    return doc_freqs;
+}
+
+/**
+ * @brief Print how much the summaries of the given documents change when
+ * they are computed with the approximate instead of the exact document
+ * frequencies to STDERR, for the OOV policies that treat the terms left out
+ * of the approximate model differently.
+ *
+ * @param docs Sampled documents.
+ * @param approx_model Model of the approximate document frequencies.
+ * @param exact_model Model of the exact document frequencies of every term
+ * of the sampled documents.
+ */
+static void report_summaries(const std::vector<ir::RawDocument>& docs,
+                             const ir::IdfModel& approx_model,
+                             const ir::IdfModel& exact_model) {
+    const std::pair<ir::OovPolicy, const char*> policies[] = {
+        {ir::OovPolicy::Ignore, "ignore"}, {ir::OovPolicy::MaxIdf, "max-idf"}};
+    for (const auto& policy : policies) {
+        ir::LexrankOptions options;
+        options.oov = policy.first;
+
+        size_t n_same = 0;
+        double max_dev = 0;
+        for (const auto& doc : docs) {
+            const ir::Summary approx = ir::summarize(
+                doc, approx_model, ir::SummarySentenceCount, options);
+            const ir::Summary exact = ir::summarize(
+                doc, exact_model, ir::SummarySentenceCount, options);
+            n_same += approx.top_sentences == exact.top_sentences;
+            for (size_t i = 0; i < exact.scores.size(); ++i) {
+                max_dev = std::max(
+                    max_dev, std::abs(approx.scores[i] - exact.scores[i]));
+            }
+        }
+        std::cerr << "approximate: with --oov " << policy.second << ", "
+                  << n_same << " of " << docs.size()
+                  << " sampled summaries are the same as with exact counts,"
+                     " LexRank scores deviate by at most "
+                  << max_dev << std::endl;
+    }
+}
+
+/**
+ * @brief Print the error bounds of approximate document frequencies and, if
+ * n_sample is positive, their measured error on a sample of the kept terms
+ * and its effect on the summaries of a sample of the documents to STDERR.
+ *
+ * The sampled terms are spread evenly over the sorted vocabulary, and the
+ * sampled documents over the corpus. The exact document frequencies of the
+ * sampled terms and of every term of the sampled documents are counted in
+ * another pass over the corpus.
+ *
+ * @param approx Approximate document frequencies of the corpus.
+ * @param doc_freqs Document frequencies of the kept terms.
+ * @param file_list List of document files of the corpus.
+ * @param n_sample Maximum number of sampled terms and of sampled documents.
+ * @param n_threads Number of threads of the exact pass.
+ *
+ * @throw std::runtime_error if a document file can't be read.
+ */
+static void
+report_approximation(const ir::ApproximateDocumentFrequencies& approx,
+                     const ir::DocumentFrequencies& doc_freqs,
+                     const std::vector<std::string>& file_list,
+                     size_t n_sample, size_t n_threads) {
+    const ir::CountMinSketch& sketch = approx.sketch();
+    // each part's sketch fails with probability at most e^-depth
+    const double confidence = std::max(
+        0.0, 1 - approx.n_parts() * std::exp(-double(sketch.depth())));
+    std::cerr << "approximate: " << doc_freqs.vocab().size() << " of at most "
+              << approx.capacity() << " terms kept, " << approx.n_parts()
+              << " sketches of " << sketch.depth() << " x " << sketch.width()
+              << " counters\n"
+              << "approximate: document frequencies are overestimated by at "
+                 "most "
+              << sketch.error_bound() << " with probability at least "
+              << confidence << std::endl;
+    if (approx.missing_df() != 0) {
+        std::cerr << "approximate: terms left out occur in at most "
+                  << approx.missing_df() << " documents" << std::endl;
+    }
+
+    const size_t n_terms = doc_freqs.vocab().size();
+    const size_t n_sample_terms = std::min(n_sample, n_terms);
+    const size_t n_sample_docs = std::min(n_sample, file_list.size());
+    if (n_sample_terms == 0 && n_sample_docs == 0) {
+        return;
+    }
+
+    std::vector<ir::term_id> sample_ids(n_sample_terms);
+    std::vector<std::string> terms(n_sample_terms);
+    for (size_t i = 0; i < n_sample_terms; ++i) {
+        sample_ids[i] = n_terms * i / n_sample_terms;
+        terms[i] = doc_freqs.vocab().term(sample_ids[i]);
+    }
+
+    // every term of the sampled documents is counted exactly as well
+    std::vector<ir::RawDocument> docs(n_sample_docs);
+    ir::Vocabulary doc_vocab;
+    for (size_t i = 0; i < n_sample_docs; ++i) {
+        const std::string& path = file_list[file_list.size() * i /
+                                            n_sample_docs];
+        std::ifstream ifs(path);
+        docs[i] = ir::parse_doc_file(ifs);
+        if (not ifs.is_open() || ifs.bad()) {
+            throw std::runtime_error("Couldn't read " + path);
+        }
+        ir::normalize_document(docs[i], doc_vocab);
+    }
+    for (ir::term_id id = 0; id < doc_vocab.size(); ++id) {
+        terms.push_back(doc_vocab.term(id));
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    const std::vector<size_t> exact =
+        ir::term_document_frequencies(file_list, terms, n_threads);
+
+    const double n_docs = doc_freqs.n_docs();
+    double max_dev = 0, sum_dev = 0;
+    size_t max_over = 0;
+    for (size_t i = 0; i < n_sample_terms; ++i) {
+        const size_t approx_df = doc_freqs.df(sample_ids[i]);
+        const std::string term = doc_freqs.vocab().term(sample_ids[i]);
+        const size_t exact_df =
+            exact[std::lower_bound(terms.begin(), terms.end(), term) -
+                  terms.begin()];
+        assert(exact_df > 0 && exact_df <= approx_df);
+
+        const double dev =
+            std::log10(n_docs / exact_df) - std::log10(n_docs / approx_df);
+        max_dev = std::max(max_dev, dev);
+        sum_dev += dev;
+        max_over = std::max(max_over, approx_df - exact_df);
+    }
+    if (n_sample_terms != 0) {
+        std::cerr << "approximate: idf of " << n_sample_terms
+                  << " sampled terms deviates from the exact idf by at most "
+                  << max_dev << " (mean " << sum_dev / n_sample_terms
+                  << "), document frequencies are overestimated by at most "
+                  << max_over << std::endl;
+    }
+
+    // every counted term occurs in a sampled document or is kept
+    ir::Vocabulary exact_vocab;
+    for (const auto& term : terms) {
+        exact_vocab.intern(term);
+    }
+    const ir::IdfModel exact_model(exact_vocab, exact, doc_freqs.n_docs());
+    const ir::IdfModel approx_model(doc_freqs.vocab(), doc_freqs.doc_freqs(),
+                                    doc_freqs.n_docs(), doc_freqs.pruned(),
+                                    doc_freqs.missing_df());
+    report_summaries(docs, approx_model, exact_model);
+}
+
 /**
  * @brief IDF calculation main program.
  *
  * Main program
  *
  * i.   reads command-line arguments,
- * ii.  parses, tokenizes, normalizes every document in the corpus,
+ * ii.  streams every document in the corpus through parsing, tokenization
+ *      and normalization, builds the corpus vocabulary and counts document
+ *      frequencies using multiple threads,
  * iii. computes idf scores
- * iv.  writes idf scores to ir::IDF_FILEPATH.
+ * iv.  writes the vocabulary and idf scores to ir::IDF_FILEPATH, and the
+ *      vocabulary and document frequencies to ir::IDF_MODEL_FILEPATH.
+ *
+ * With --add or --remove, the documents in the dataset folder are counted
+ * in the same way, and their counts are added to or subtracted from the
+ * counts of the existing model at ir::IDF_MODEL_FILEPATH instead of
+ * replacing them. The result is the same as counting the updated corpus from
+ * scratch.
+ *
+ * With --shard i/N, only the i-th of N contiguous slices of the sorted
+ * document list is counted (0 <= i < N), and the counts are written in the
+ * binary model format to idf-<i>-of-<N>.part instead. Shards can be counted
+ * by independent processes, and --merge combines the shard files given in
+ * place of the dataset folder by a k-way merge of their sorted terms,
+ * writing the same files as counting the whole corpus in one process.
+ *
+ * With --approximate <MiB>, document frequencies are counted approximately
+ * in the given amount of memory (see ir::ApproximateDocumentFrequencies),
+ * and only the most frequent terms are written. Their error bounds are
+ * printed to STDERR; --validate <n> additionally counts n of the kept terms
+ * and the terms of n documents exactly in a second pass, and prints the
+ * measured idf deviation and how much the summaries of the n documents
+ * change.
+ *
+ * With --cache <path>, documents are normalized only if their name or
+ * contents changed since the document cache at the given path was written
+ * (see ir::DocumentCache); the others are read from the cache. The cache is
+ * then rewritten with the counted documents. An invalid cache, e.g. one
+ * built with another stopword list, is ignored and replaced.
+ *
+ * Finally, terms occurring in fewer than --min-df documents or in more than
+ * --max-df (a ratio) of the documents are pruned. Counts of a pruned model
+ * can't be updated or merged anymore, so shards are never pruned.
  *
  * @param argc Number of command-line arguments including program name.
  * @param argv Command-line arguments string array.
@@ -27,25 +319,182 @@
  */
 int main(int argc, char** argv) {
     // read command line arguments
-    if (argc != 2) {
-        std::cout << "Usage: " << argv[0] << " <Dataset_folder>" << std::endl;
+    std::vector<std::string> paths;
+    std::string cache_path;
+    size_t n_threads = 0;
+    size_t shard = 0, n_shards = 0;
+    size_t approximate_mib = 0, n_validate = 0;
+    size_t min_df = 1;
+    double max_df_ratio = 1;
+    bool add = false, remove = false, merge = false;
+    bool valid_args = true;
+    try {
+        for (int i = 1; i < argc && valid_args; ++i) {
+            const std::string arg(argv[i]);
+            if (arg == "--add") {
+                add = true;
+            } else if (arg == "--remove") {
+                remove = true;
+            } else if (arg == "--merge") {
+                merge = true;
+            } else if (arg == "--shard" && i + 1 < argc) {
+                const std::string spec(argv[++i]);
+                const size_t slash = spec.find('/');
+                valid_args = slash != std::string::npos;
+                shard = std::stoul(spec.substr(0, slash));
+                n_shards = std::stoul(spec.substr(slash + 1));
+                valid_args = valid_args && shard < n_shards;
+            } else if (arg == "--approximate" && i + 1 < argc) {
+                approximate_mib = std::stoul(argv[++i]);
+                valid_args = approximate_mib > 0;
+            } else if (arg == "--validate" && i + 1 < argc) {
+                n_validate = std::stoul(argv[++i]);
+            } else if (arg == "--min-df" && i + 1 < argc) {
+                min_df = std::stoul(argv[++i]);
+            } else if (arg == "--max-df" && i + 1 < argc) {
+                max_df_ratio = std::stod(argv[++i]);
+                valid_args = max_df_ratio > 0 && max_df_ratio <= 1;
+            } else if (arg == "--cache" && i + 1 < argc) {
+                cache_path = argv[++i];
+            } else if (arg == "--threads" && i + 1 < argc) {
+                n_threads = std::stoul(argv[++i]);
+            } else if (arg == "--stopwords" && i + 1 < argc) {
+                ir::load_stopwords(argv[++i]);
+            } else if (arg.compare(0, 2, "--") != 0) {
+                paths.push_back(arg);
+            } else {
+                valid_args = false;
+            }
+        }
+    } catch (const std::logic_error&) {
+        // malformed number
+        valid_args = false;
+    }
+    // at most one mode; only --merge takes more than one path
+    const int n_modes =
+        add + remove + merge + (n_shards != 0) + (approximate_mib != 0);
+    const bool prune = min_df > 1 || max_df_ratio < 1;
+    valid_args = valid_args && n_modes <= 1 && not paths.empty() &&
+                 (merge || paths.size() == 1) &&
+                 (n_validate == 0 || approximate_mib != 0) &&
+                 (cache_path.empty() || not(merge || approximate_mib != 0)) &&
+                 not(prune && n_shards != 0);
+    if (not valid_args) {
+        std::cout << "Usage: " << argv[0]
+                  << " <Dataset_folder> [--add | --remove | --shard <i>/<N>"
+                     " | --approximate <MiB> [--validate <n>]]"
+                     " [--min-df <n>] [--max-df <ratio>] [--cache <path>]"
+                     " [--threads <n>] [--stopwords <path>]\n"
+                  << "       " << argv[0]
+                  << " --merge <part>... [--min-df <n>] [--max-df <ratio>]"
+                  << std::endl;
         return -1;
     }
-    std::string dataset_dir(argv[1]);
 
-    // get filepath of all documents to be used
-    std::vector<std::string> file_list = ir::get_data_file_list(dataset_dir);
+    ir::DocumentFrequencies doc_freqs;
+    if (merge) {
+        // combine the counts of the shards
+        try {
+            std::vector<ir::IdfModel> parts;
+            for (const auto& path : paths) {
+                parts.emplace_back(path);
+            }
+            doc_freqs = ir::DocumentFrequencies(parts);
+        } catch (const std::exception& e) {
+            std::cerr << "Couldn't merge shards: " << e.what() << std::endl;
+            return -1;
+        }
+    } else {
+        // get filepath of all documents to be used
+        std::vector<std::string> file_list = ir::get_data_file_list(paths[0]);
+        ir::TermCacheStats term_stats;
 
-    // parse documents and create raw documents
-    auto raw_docs = ir::docs_from_files(file_list);
+        // keep the slice of the shard; the list is sorted, so every process
+        // agrees on the slices
+        if (n_shards != 0) {
+            const size_t begin = file_list.size() * shard / n_shards;
+            const size_t end = file_list.size() * (shard + 1) / n_shards;
+            file_list.erase(file_list.begin() + end, file_list.end());
+            file_list.erase(file_list.begin(), file_list.begin() + begin);
+        }
 
-    // normalize documents
-    auto norm_docs = ir::normalized_docs_from_raw_docs(raw_docs);
+        if (approximate_mib != 0) {
+            // count in a fixed amount of memory and keep the frequent terms
+            try {
+                const auto approx = ir::corpus_approximate_document_frequencies(
+                    file_list, n_threads, approximate_mib << 20, &term_stats);
+                doc_freqs = approx.document_frequencies();
+                report_approximation(approx, doc_freqs, file_list, n_validate,
+                                     n_threads);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        } else {
+            // parse and normalize documents, build the vocabulary and count
+            // document frequencies in parallel
+            try {
+                doc_freqs =
+                    cache_path.empty()
+                        ? ir::corpus_document_frequencies(
+                              file_list, n_threads, nullptr, &term_stats)
+                        : cached_document_frequencies(file_list, n_threads,
+                                                      cache_path, term_stats);
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        }
+        std::cerr << "term cache: " << term_stats.hits << " hits, "
+                  << term_stats.misses << " misses" << std::endl;
+    }
+
+    // update the counts of the existing model with the counted documents
+    if (add || remove) {
+        try {
+            // the counted terms are sorted, like the terms of the model
+            const ir::DocumentFrequencies batch = std::move(doc_freqs);
+            doc_freqs = ir::DocumentFrequencies(
+                ir::IdfModel(ir::IDF_MODEL_FILEPATH), batch, remove);
+        } catch (const std::exception& e) {
+            std::cerr << "Couldn't update " << ir::IDF_MODEL_FILEPATH << ": "
+                      << e.what() << std::endl;
+            return -1;
+        }
+    }
+    // write the counts of the shard only, even if it has no documents; idf
+    // scores need the whole corpus
+    if (n_shards != 0) {
+        const std::string part_path = "idf-" + std::to_string(shard) +
+                                      "-of-" + std::to_string(n_shards) +
+                                      ".part";
+        if (not write_model_file(part_path, doc_freqs)) {
+            std::cerr << "Couldn't write " << part_path << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (doc_freqs.n_docs() == 0) {
+        std::cerr << "No documents to compute idf scores" << std::endl;
+        return -1;
+    }
+    if (prune) {
+        doc_freqs.prune(min_df, max_df_ratio);
+    }
+
+    const ir::Vocabulary& vocab = doc_freqs.vocab();
 
     // compute IDF score of each term
-    auto idf_scores = ir::idf_scores(norm_docs);
+    auto idf_scores = doc_freqs.idf_scores();
 
-    // write IDF scores to file
+    // write vocabulary and IDF scores to file
     std::ofstream out_idf_file(ir::IDF_FILEPATH);
-    ir::write_idf_file(out_idf_file, idf_scores);
+    ir::write_idf_file(out_idf_file, vocab, idf_scores);
+
+    // write the counts in binary format to be memory-mapped by lexrank
+    if (not write_model_file(ir::IDF_MODEL_FILEPATH, doc_freqs)) {
+        std::cerr << "Couldn't write " << ir::IDF_MODEL_FILEPATH << std::endl;
+        return -1;
+    }
 }
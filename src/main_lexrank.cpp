@@ -1,46 +1,23 @@
+#include "batch.hpp"
 #include "file_manager.hpp"
-#include "lexrank.hpp"
 #include "parser.hpp"
+#include "summarizer.hpp"
 #include "tokenizer.hpp"
-#include "vector_space_model.hpp"
-#include <algorithm>
 #include <cassert>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <unordered_map>
+#include <sstream>
+#include <stdexcept>
 
 /**
- * @brief Print LexRank scores and top 3 LexRank sentences as summary
- *
- * @param lexrank_scores Vector containing LexRank score of each sentence in
- * the given raw document.
- * @param raw_doc Raw document containing the original sentences.
+ * @brief Print the given statistics of ir::GraphMethod::Approximate to
+ * STDERR.
  */
-static void print_summary(const std::vector<double>& lexrank_scores,
-                          const ir::RawDocument& raw_doc) {
-    // output lexrank scores
-    for (size_t i = 0; i < lexrank_scores.size(); ++i) {
-        double score = lexrank_scores[i];
-        auto sentence = raw_doc.sentences[i];
-        std::cout << std::fixed << std::setprecision(6) << score << '\n';
-    }
-    std::cout << std::endl;
-
-    // sort sentences with respect to lexrank
-    std::vector<std::pair<double, int>> scores_indices;
-    for (size_t i = 0; i < lexrank_scores.size(); ++i) {
-        scores_indices.emplace_back(lexrank_scores[i], i);
-    }
-    std::sort(scores_indices.begin(), scores_indices.end(),
-              [](const auto& left, const auto& right) {
-                  return left.first >= right.first;
-              });
-
-    // print top 3 LexRank sentences
-    for (size_t i = 0; i < 3; ++i) {
-        std::cout << raw_doc.sentences[scores_indices[i].second] << std::endl;
-    }
+static void print_lsh_stats(const ir::LshStats& lsh) {
+    std::cerr << "lsh: " << lsh.candidates << " candidate pairs, " << lsh.edges
+              << " edges, estimated recall " << lsh.recall << " ("
+              << lsh.sample_found << '/' << lsh.sample_edges
+              << " sampled edges found)" << std::endl;
 }
 
 /**
@@ -49,50 +26,169 @@ static void print_summary(const std::vector<double>& lexrank_scores,
  * Main program
  *
  *   i.   reads command-line arguments,
- *   ii.  parses, tokenizes, normalizes the target document,
- *   iii. reads idf scores,
+ *   ii.  maps the corpus vocabulary and idf scores,
+ *   iii. parses, tokenizes, normalizes the target document,
  *   iv.  computes LexRank scores,
  *   v.   prints LexRank scores and a summary using the top 3 LexRank sentences.
  *
+ * In batch mode (--batch), every document of a dataset folder, or every JSON
+ * line document read from STDIN if the folder is "-", is summarized
+ * concurrently, and the results are printed as JSON lines (see
+ * ir::summarize_files and ir::summarize_jsonl).
+ *
+ * With --cache <path>, documents found unchanged in the document cache
+ * written by idf --cache are read from the cache instead of being tokenized
+ * and normalized again (see ir::DocumentCache). Their text is still parsed
+ * for the summary sentences.
+ *
  * @param argc Number of command-line arguments including program name.
  * @param argv Command-line arguments string array.
- * @return -1 if incorrect arguments are given; 0 if program executed
- * successfully.
+ * @return -1 if incorrect arguments are given or the document can't be
+ * summarized; 0 if program executed successfully.
  */
 int main(int argc, char** argv) {
     // read command line arguments
-    if (argc != 3) {
-        std::cout << "Usage: " << argv[0] << " <Dataset_folder> <filename>"
+    const bool batch = argc >= 2 && std::string(argv[1]) == "--batch";
+    ir::BatchOptions batch_options;
+    ir::LexrankOptions& options = batch_options.lexrank;
+    std::string cache_path;
+    bool threads_given = false;
+    bool valid_args = argc >= 3;
+    try {
+        for (int i = 3; i < argc && valid_args; ++i) {
+            const std::string arg(argv[i]);
+            if (arg == "--stopwords" && i + 1 < argc) {
+                ir::load_stopwords(argv[++i]);
+            } else if (arg == "--solver" && i + 1 < argc) {
+                options.solver.method =
+                    ir::solver_method_from_name(argv[++i]);
+            } else if (arg == "--graph" && i + 1 < argc) {
+                options.graph = ir::graph_method_from_name(argv[++i]);
+            } else if (arg == "--oov" && i + 1 < argc) {
+                options.oov = ir::oov_policy_from_name(argv[++i]);
+            } else if (arg == "--cache" && i + 1 < argc) {
+                cache_path = argv[++i];
+            } else if (arg == "--threads" && i + 1 < argc) {
+                // documents of a batch are summarized in parallel instead
+                (batch ? batch_options.n_threads : options.graph_threads) =
+                    std::stoul(argv[++i]);
+                threads_given = true;
+            } else if (arg == "--lsh-bands" && i + 1 < argc) {
+                options.lsh.bands = std::stoul(argv[++i]);
+            } else if (arg == "--lsh-rows" && i + 1 < argc) {
+                options.lsh.rows = std::stoul(argv[++i]);
+                valid_args = options.lsh.rows >= 1 && options.lsh.rows <= 64;
+            } else {
+                valid_args = false;
+            }
+        }
+    } catch (const std::logic_error&) {
+        // unknown method or policy name, or malformed number
+        valid_args = false;
+    }
+    // a single document uses threads only to compare every sentence pair
+    valid_args = valid_args &&
+                 (batch || not threads_given ||
+                  options.graph == ir::GraphMethod::Exhaustive);
+    if (not valid_args) {
+        std::cout << "Usage: " << argv[0]
+                  << " <Dataset_folder> <filename> [--stopwords <path>]"
+                     " [--solver <method>] [--graph <method>]"
+                     " [--threads <n>] [--lsh-bands <b>] [--lsh-rows <r>]"
+                     " [--oov <policy>] [--cache <path>]\n"
+                  << "       " << argv[0]
+                  << " --batch <Dataset_folder|-> [options]\n"
+                  << "--threads requires --graph exhaustive without --batch"
                   << std::endl;
         return -1;
     }
-    std::string dataset_dir(argv[1]);
-    std::string filepath = dataset_dir + '/' + std::string(argv[2]);
 
-    // put file to summarize into vector
-    std::vector<std::string> file_list = {filepath};
+    // lsh graphs keep an edge at the similarity threshold only with the
+    // probability of becoming a candidate pair
+    const double lsh_probability =
+        ir::lsh_candidate_probability(options.lsh, ir::LexrankEdgeThreshold);
+    if (options.graph == ir::GraphMethod::Approximate &&
+        lsh_probability < ir::LshMinCandidateProbability) {
+        std::cerr << "warning: --graph lsh finds a pair of sentences at the "
+                     "edge threshold with probability "
+                  << lsh_probability
+                  << ", so most edges may be dropped; use --graph indexed or "
+                     "more --lsh-bands"
+                  << std::endl;
+    }
 
-    // parse document and create raw document
-    const auto raw_docs = ir::docs_from_files(file_list);
+    // map corpus vocabulary and IDF scores
+    const ir::IdfModel idf_model = ir::load_idf_model();
 
-    // normalize document
-    const auto norm_docs = ir::normalized_docs_from_raw_docs(raw_docs);
+    // map normalized documents; a cache that can't be used is only skipped
+    ir::DocumentCache cache;
+    if (not cache_path.empty()) {
+        try {
+            cache = ir::DocumentCache(cache_path);
+            batch_options.cache = &cache;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ignoring " << cache_path << ": " << e.what()
+                      << std::endl;
+        }
+    }
 
-    // read IDF scores
-    std::unordered_map<std::string, double> idf_scores;
-    {
-        std::ifstream idf_file(ir::IDF_FILEPATH);
-        ir::read_idf_file(idf_file, idf_scores);
+    if (batch) {
+        const std::string source(argv[2]);
+        const ir::BatchStats stats =
+            source == "-" ? ir::summarize_jsonl(std::cin, idf_model,
+                                                std::cout, batch_options)
+                          : ir::summarize_files(ir::get_data_file_list(source),
+                                                idf_model, std::cout,
+                                                batch_options);
+        std::cerr << "batch: " << stats.documents << " documents, "
+                  << stats.failed << " failed" << std::endl;
+        if (options.graph == ir::GraphMethod::Approximate) {
+            print_lsh_stats(stats.lsh);
+        }
+        std::cerr << "term cache: " << stats.term_cache.hits << " hits, "
+                  << stats.term_cache.misses << " misses" << std::endl;
+        return 0;
     }
 
-    // get ID and raw/normalized version of target document
-    const size_t doc_id = ir::doc_id_from_filepath(filepath);
-    const ir::RawDocument rawdoc_to_process = raw_docs.at(doc_id);
-    const ir::NormalizedDocument doc_to_process = norm_docs.at(doc_id);
+    std::string dataset_dir(argv[1]);
+    std::string filepath = dataset_dir + '/' + std::string(argv[2]);
+
+    // parse document and create raw document
+    std::string contents;
+    const bool read = ir::read_file(filepath, contents);
+    assert(read && "File couldn't be opened to read in lexrank");
+    (void)read;
+    std::istringstream iss(contents);
+    const ir::RawDocument raw_doc = ir::parse_doc_file(iss);
 
-    // compute LexRank scores
-    std::vector<double> lexrank_scores = lexrank(doc_to_process, idf_scores);
+    // normalize document, or read it from the cache if it didn't change, and
+    // compute LexRank scores and summary
+    const size_t index =
+        batch_options.cache
+            ? cache.find(ir::doc_name_from_filepath(filepath),
+                         ir::content_hash(contents))
+            : ir::NoCachedDocument;
+    ir::Summary summary;
+    try {
+        if (index != ir::NoCachedDocument) {
+            ir::Vocabulary vocab(idf_model);
+            summary = ir::summarize(cache.document(index, vocab), idf_model,
+                                    ir::SummarySentenceCount, options);
+        } else {
+            summary = ir::summarize(raw_doc, idf_model,
+                                    ir::SummarySentenceCount, options);
+        }
+    } catch (const std::out_of_range& e) {
+        // a term is missing from the model with --oov error
+        std::cerr << "Couldn't summarize " << filepath << ": " << e.what()
+                  << std::endl;
+        return -1;
+    }
 
     // print summary and scores
-    print_summary(lexrank_scores, rawdoc_to_process);
+    ir::write_summary(std::cout, summary, raw_doc) << std::flush;
+
+    if (options.graph == ir::GraphMethod::Approximate) {
+        print_lsh_stats(summary.stats.lsh);
+    }
 }
@@ -0,0 +1,675 @@
+#include "file_manager.hpp"
+#include "summarizer.hpp"
+#include "thread_pool.hpp"
+#include "tokenizer.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Buffered line reader over a file descriptor.
+ */
+class LineReader {
+  public:
+    /**
+     * @brief Construct a reader of the given file descriptor.
+     *
+     * @param fd File descriptor to read from.
+     */
+    explicit LineReader(int fd) : m_fd(fd), m_buffer(1 << 16) {}
+
+    /**
+     * @brief Read the next line without the trailing newline character.
+     *
+     * @param line String to store the line.
+     * @return false if there is no more input; true, otherwise.
+     */
+    bool getline(std::string& line) {
+        line.clear();
+        while (true) {
+            // consume buffered bytes up to the next newline
+            const char* begin = m_buffer.data() + m_begin;
+            const char* end = m_buffer.data() + m_end;
+            const char* newline =
+                static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+            if (newline != nullptr) {
+                line.append(begin, newline);
+                m_begin += (newline - begin) + 1;
+                return true;
+            }
+            line.append(begin, end);
+            m_begin = m_end = 0;
+
+            ssize_t n_read;
+            do {
+                n_read = ::read(m_fd, m_buffer.data(), m_buffer.size());
+            } while (n_read < 0 && errno == EINTR);
+
+            if (n_read <= 0) {
+                // last line may not end with a newline
+                return !line.empty();
+            }
+            m_end = static_cast<size_t>(n_read);
+        }
+    }
+
+  private:
+    /**
+     * @brief File descriptor to read from.
+     */
+    int m_fd;
+
+    /**
+     * @brief Read buffer.
+     */
+    std::vector<char> m_buffer;
+
+    /**
+     * @brief Range of unconsumed bytes in the buffer.
+     */
+    size_t m_begin = 0, m_end = 0;
+};
+
+/**
+ * @brief Write the whole string to the given file descriptor.
+ *
+ * @param fd File descriptor to write to.
+ * @param str String to write.
+ * @return false if writing failed; true, otherwise.
+ */
+static bool write_all(int fd, const std::string& str) {
+    size_t written = 0;
+    while (written < str.size()) {
+        ssize_t n = ::write(fd, str.data() + written, str.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Summarize the given request and return its response.
+ *
+ * The response consists of the LexRank score of each sentence (one per
+ * line), an empty line, the top_k summary sentences (one per line) and a
+ * terminating empty line. If the document can't be summarized, the response
+ * is a single line starting with "error: " followed by an empty line.
+ *
+ * @param raw_doc Requested document.
+ * @param idf_model Model storing the vocabulary and idf scores.
+ * @param top_k Number of summary sentences.
+ * @param options Graph and solver methods computing the LexRank scores.
+ * @return Response to the request.
+ */
+static std::string respond(const ir::RawDocument& raw_doc,
+                           const ir::IdfModel& idf_model, size_t top_k,
+                           const ir::LexrankOptions& options) {
+    std::ostringstream response;
+    try {
+        const ir::Summary summary =
+            ir::summarize(raw_doc, idf_model, top_k, options);
+        ir::write_summary(response, summary, raw_doc) << '\n';
+    } catch (const std::exception& e) {
+        response.str("");
+        response << "error: " << e.what() << "\n\n";
+    }
+    return response.str();
+}
+
+/**
+ * @brief Serve summarization requests read from in_fd until end of input.
+ *
+ * A request is a document with one sentence per line, terminated by an empty
+ * line. The response of each request (see respond) is written to out_fd
+ * before the next request is read.
+ *
+ * @param in_fd File descriptor to read requests from.
+ * @param out_fd File descriptor to write responses to.
+ * @param idf_model Model storing the vocabulary and idf scores.
+ * @param top_k Number of summary sentences.
+ * @param options Graph and solver methods computing the LexRank scores.
+ */
+static void serve(int in_fd, int out_fd, const ir::IdfModel& idf_model,
+                  size_t top_k, const ir::LexrankOptions& options) {
+    LineReader reader(in_fd);
+    std::string line;
+
+    while (true) {
+        // read sentences until an empty line
+        ir::RawDocument raw_doc;
+        bool has_input = false;
+        while (reader.getline(line)) {
+            has_input = true;
+            if (line.empty()) {
+                break;
+            }
+            raw_doc.sentences.push_back(line);
+        }
+        if (not has_input) {
+            return;
+        }
+
+        if (not write_all(out_fd, respond(raw_doc, idf_model, top_k,
+                                          options))) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Create a non-blocking Unix domain stream socket listening at the
+ * given path.
+ *
+ * An existing file at the path is removed.
+ *
+ * @param path Filesystem path of the socket.
+ * @return File descriptor of the listening socket; -1 on failure.
+ */
+static int listen_unix(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Set by the SIGINT and SIGTERM handlers to stop the server.
+ */
+static volatile std::sig_atomic_t stop_requested = 0;
+
+/**
+ * @brief Write end of the pipe that wakes up the event loop of serve_socket.
+ */
+static int wake_fd = -1;
+
+/**
+ * @brief Wake up the event loop by writing a byte to its pipe.
+ *
+ * The pipe is non-blocking; if it is full, the loop is already awake.
+ */
+static void wake_up() {
+    const char byte = 0;
+    while (::write(wake_fd, &byte, 1) < 0 && errno == EINTR) {
+    }
+}
+
+/**
+ * @brief SIGINT and SIGTERM handler requesting the server to stop.
+ */
+static void request_stop(int) {
+    stop_requested = 1;
+    wake_up();
+}
+
+/**
+ * @brief Number of complete requests of a connection waiting to be
+ * summarized at which serve_socket stops reading the connection.
+ */
+static const size_t MaxPendingRequests = 16;
+
+/**
+ * @brief Maximum size in bytes of a request, including its line terminators.
+ * A connection sending a larger request receives an error and is closed.
+ */
+static const size_t MaxRequestSize = 16 << 20;
+
+/**
+ * @brief State of a client connection of serve_socket.
+ */
+struct Connection {
+    /**
+     * @brief Socket of the connection.
+     */
+    int fd;
+
+    /**
+     * @brief Received bytes that don't form a complete line yet.
+     */
+    std::string input;
+
+    /**
+     * @brief Sentences of the request being received.
+     */
+    ir::RawDocument request;
+
+    /**
+     * @brief Size in bytes of the complete lines of the request being
+     * received.
+     */
+    size_t request_size = 0;
+
+    /**
+     * @brief Complete requests waiting to be summarized, in arrival order.
+     */
+    std::deque<ir::RawDocument> requests;
+
+    /**
+     * @brief Whether a request of the connection is being summarized.
+     */
+    bool busy = false;
+
+    /**
+     * @brief Response bytes that aren't written yet.
+     */
+    std::string output;
+
+    /**
+     * @brief Whether the client closed its side of the connection.
+     */
+    bool input_closed = false;
+
+    /**
+     * @brief Whether a request exceeded MaxRequestSize, so its error is
+     * written after the responses of the earlier requests and the connection
+     * is closed.
+     */
+    bool too_large = false;
+
+    /**
+     * @brief Whether reading or writing failed, so the connection is closed
+     * immediately.
+     */
+    bool failed = false;
+};
+
+/**
+ * @brief Split the complete lines of the received bytes of a connection into
+ * requests. At end of input, the last line and request needn't be
+ * terminated.
+ */
+static void parse_requests(Connection& conn) {
+    size_t begin = 0;
+    for (size_t end; (end = conn.input.find('\n', begin)) != std::string::npos;
+         begin = end + 1) {
+        if (end == begin) {
+            // an empty line terminates the request
+            conn.requests.push_back(std::move(conn.request));
+            conn.request = ir::RawDocument();
+            conn.request_size = 0;
+        } else {
+            conn.request.sentences.emplace_back(conn.input, begin,
+                                                end - begin);
+            conn.request_size += end - begin + 1;
+        }
+    }
+    conn.input.erase(0, begin);
+
+    if (conn.input_closed) {
+        if (not conn.input.empty()) {
+            conn.request.sentences.push_back(std::move(conn.input));
+            conn.input.clear();
+        }
+        if (not conn.request.sentences.empty()) {
+            conn.requests.push_back(std::move(conn.request));
+            conn.request = ir::RawDocument();
+            conn.request_size = 0;
+        }
+    }
+}
+
+/**
+ * @brief Read the available bytes of a connection and parse its requests,
+ * until MaxPendingRequests requests are waiting.
+ *
+ * If the request being received exceeds MaxRequestSize, the rest of the
+ * input is ignored and the connection is marked as too large.
+ */
+static void read_requests(Connection& conn) {
+    char buffer[1 << 16];
+    while (not conn.input_closed &&
+           conn.requests.size() < MaxPendingRequests) {
+        const ssize_t n_read = ::read(conn.fd, buffer, sizeof(buffer));
+        if (n_read > 0) {
+            conn.input.append(buffer, static_cast<size_t>(n_read));
+            parse_requests(conn);
+            if (conn.request_size + conn.input.size() > MaxRequestSize) {
+                conn.too_large = true;
+                conn.input_closed = true;
+                conn.input.clear();
+                conn.request = ir::RawDocument();
+                conn.request_size = 0;
+                return;
+            }
+        } else if (n_read == 0) {
+            conn.input_closed = true;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            conn.failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            break;
+        }
+    }
+    parse_requests(conn);
+}
+
+/**
+ * @brief Write as many pending response bytes of a connection as possible.
+ */
+static void write_responses(Connection& conn) {
+    size_t written = 0;
+    while (written < conn.output.size()) {
+        const ssize_t n = ::write(conn.fd, conn.output.data() + written,
+                                  conn.output.size() - written);
+        if (n > 0) {
+            written += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            conn.failed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+    }
+    conn.output.erase(0, written);
+}
+
+/**
+ * @brief Serve summarization requests of every connection to the given
+ * listening socket until SIGINT or SIGTERM is received.
+ *
+ * A single thread polls the listening socket and all connections; it accepts
+ * connections, reads and parses requests (see serve) and writes responses
+ * without blocking. Each request is summarized by a separate task on a pool
+ * of worker threads, so idle or slow clients never occupy a worker. At most
+ * one request of a connection is summarized at a time, so that its
+ * responses are written in request order, while requests of different
+ * connections are summarized concurrently. A connection isn't read while
+ * MaxPendingRequests of its requests are waiting, so a client sending
+ * faster than it is served is slowed down instead of filling the memory.
+ *
+ * On stop, no more requests are read, the requests being summarized are
+ * finished, and every connection is closed.
+ *
+ * @param listen_fd Non-blocking listening socket.
+ * @param wake_read_fd Read end of the pipe whose write end is wake_fd.
+ * @param n_threads Number of worker threads. If 0, the number of hardware
+ * threads is used.
+ * @param idf_model Model storing the vocabulary and idf scores.
+ * @param top_k Number of summary sentences.
+ * @param options Graph and solver methods computing the LexRank scores.
+ */
+static void serve_socket(int listen_fd, int wake_read_fd, size_t n_threads,
+                         const ir::IdfModel& idf_model, size_t top_k,
+                         const ir::LexrankOptions& options) {
+    // responses of finished tasks by connection ID
+    std::mutex done_mutex;
+    std::vector<std::pair<size_t, std::string>> done;
+
+    // connections by a never reused ID, so that a response can't reach a
+    // new connection reusing the socket of a closed one
+    std::map<size_t, Connection> conns;
+    size_t next_id = 0;
+
+    ir::ThreadPool pool(n_threads);
+    std::vector<pollfd> poll_fds;
+    std::vector<size_t> poll_ids;
+    while (not stop_requested) {
+        poll_fds.assign({{wake_read_fd, POLLIN, 0}, {listen_fd, POLLIN, 0}});
+        poll_ids.clear();
+        for (const auto& entry : conns) {
+            const Connection& conn = entry.second;
+            // stop reading while enough requests are waiting
+            const bool readable = not conn.input_closed &&
+                                  conn.requests.size() < MaxPendingRequests;
+            short events = readable ? POLLIN : 0;
+            if (not conn.output.empty()) {
+                events |= POLLOUT;
+            }
+            // a negative descriptor is ignored, so that a hung up
+            // connection waiting for its responses doesn't wake the loop
+            poll_fds.push_back({events != 0 ? conn.fd : -1, events, 0});
+            poll_ids.push_back(entry.first);
+        }
+
+        if (::poll(poll_fds.data(), poll_fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // drain the wake-up pipe and collect the finished responses
+        if (poll_fds[0].revents != 0) {
+            char buffer[256];
+            while (::read(wake_read_fd, buffer, sizeof(buffer)) > 0) {
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            for (auto& response : done) {
+                const auto it = conns.find(response.first);
+                if (it != conns.end()) {
+                    it->second.output += response.second;
+                    it->second.busy = false;
+                }
+            }
+            done.clear();
+        }
+
+        if (poll_fds[1].revents & POLLIN) {
+            int conn_fd;
+            while ((conn_fd = ::accept4(listen_fd, nullptr, nullptr,
+                                        SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                Connection conn;
+                conn.fd = conn_fd;
+                conns.emplace(next_id++, std::move(conn));
+            }
+        }
+
+        for (size_t k = 0; k < poll_ids.size(); ++k) {
+            const auto it = conns.find(poll_ids[k]);
+            const short revents = poll_fds[k + 2].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                read_requests(it->second);
+            }
+        }
+
+        // start the next request of idle connections, write responses and
+        // close finished connections
+        for (auto it = conns.begin(); it != conns.end();) {
+            Connection& conn = it->second;
+            if (not conn.busy && not conn.requests.empty() && not conn.failed) {
+                conn.busy = true;
+                pool.submit([&idf_model, top_k, options, &done_mutex, &done,
+                             id = it->first,
+                             raw_doc = std::move(conn.requests.front())] {
+                    std::string response =
+                        respond(raw_doc, idf_model, top_k, options);
+                    {
+                        std::lock_guard<std::mutex> lock(done_mutex);
+                        done.emplace_back(id, std::move(response));
+                    }
+                    wake_up();
+                });
+                conn.requests.pop_front();
+            }
+            if (conn.too_large && not conn.busy && conn.requests.empty()) {
+                conn.output += "error: request exceeds " +
+                               std::to_string(MaxRequestSize) + " bytes\n\n";
+                conn.too_large = false;
+            }
+            if (not conn.output.empty() && not conn.failed) {
+                write_responses(conn);
+            }
+
+            const bool finished = conn.input_closed && not conn.too_large &&
+                                  not conn.busy && conn.requests.empty() &&
+                                  conn.output.empty();
+            if (conn.failed || finished) {
+                ::close(conn.fd);
+                it = conns.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // tasks refer to done; let them finish before it is destroyed
+    pool.wait();
+    for (const auto& entry : conns) {
+        ::close(entry.second.fd);
+    }
+}
+
+/**
+ * @brief LexRank summarization server main program.
+ *
+ * Main program
+ *
+ *   i.   reads command-line arguments,
+ *   ii.  maps the corpus vocabulary and idf scores once,
+ *   iii. serves summarization requests (see serve) either from standard input
+ *        or from every connection to a Unix domain socket.
+ *
+ * Socket connections are served by an event loop, and their requests are
+ * summarized concurrently by a pool of worker threads (see serve_socket). A
+ * connection can send any number of requests. The server stops cleanly on
+ * SIGINT or SIGTERM and removes the socket file.
+ *
+ * @param argc Number of command-line arguments including program name.
+ * @param argv Command-line arguments string array.
+ * @return -1 if incorrect arguments are given or the socket can't be created;
+ * 0 if program executed successfully.
+ */
+int main(int argc, char** argv) {
+    // read command line arguments
+    std::string socket_path;
+    size_t n_threads = 0;
+    size_t top_k = ir::SummarySentenceCount;
+    ir::LexrankOptions options;
+    bool valid_args = true;
+    try {
+        for (int i = 1; i < argc && valid_args; ++i) {
+            const std::string arg(argv[i]);
+            if (arg == "--socket" && i + 1 < argc) {
+                socket_path = argv[++i];
+            } else if (arg == "--threads" && i + 1 < argc) {
+                n_threads = std::stoul(argv[++i]);
+            } else if (arg == "--top" && i + 1 < argc) {
+                top_k = std::stoul(argv[++i]);
+            } else if (arg == "--stopwords" && i + 1 < argc) {
+                ir::load_stopwords(argv[++i]);
+            } else if (arg == "--solver" && i + 1 < argc) {
+                options.solver.method =
+                    ir::solver_method_from_name(argv[++i]);
+            } else if (arg == "--graph" && i + 1 < argc) {
+                options.graph = ir::graph_method_from_name(argv[++i]);
+            } else if (arg == "--oov" && i + 1 < argc) {
+                options.oov = ir::oov_policy_from_name(argv[++i]);
+            } else if (arg == "--lsh-bands" && i + 1 < argc) {
+                options.lsh.bands = std::stoul(argv[++i]);
+            } else if (arg == "--lsh-rows" && i + 1 < argc) {
+                options.lsh.rows = std::stoul(argv[++i]);
+                valid_args = options.lsh.rows >= 1 && options.lsh.rows <= 64;
+            } else {
+                valid_args = false;
+            }
+        }
+    } catch (const std::logic_error&) {
+        // unknown method or policy name, or malformed number
+        valid_args = false;
+    }
+    if (not valid_args) {
+        std::cout << "Usage: " << argv[0]
+                  << " [--socket <path>] [--threads <n>] [--top <k>]"
+                     " [--stopwords <path>] [--solver <method>]"
+                     " [--graph <method>] [--lsh-bands <b>] [--lsh-rows <r>]"
+                     " [--oov <policy>]"
+                  << std::endl;
+        return -1;
+    }
+
+    // the recall of lsh graphs isn't reported, so warn about the default
+    // parameters that drop most edges at the similarity threshold
+    options.lsh.recall_sample = 0;
+    const double lsh_probability =
+        ir::lsh_candidate_probability(options.lsh, ir::LexrankEdgeThreshold);
+    if (options.graph == ir::GraphMethod::Approximate &&
+        lsh_probability < ir::LshMinCandidateProbability) {
+        std::cerr << "warning: --graph lsh finds a pair of sentences at the "
+                     "edge threshold with probability "
+                  << lsh_probability
+                  << ", so most edges may be dropped; use --graph indexed or "
+                     "more --lsh-bands"
+                  << std::endl;
+    }
+
+    // map the model that is shared by the requests
+    const ir::IdfModel idf_model = ir::load_idf_model();
+
+    if (socket_path.empty()) {
+        serve(STDIN_FILENO, STDOUT_FILENO, idf_model, top_k, options);
+        return 0;
+    }
+
+    // closed connections must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = listen_unix(socket_path);
+    if (listen_fd < 0) {
+        std::cerr << "Couldn't listen on " << socket_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    int wake_fds[2];
+    if (::pipe2(wake_fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        std::cerr << "Couldn't create a pipe: " << std::strerror(errno)
+                  << std::endl;
+        ::close(listen_fd);
+        return -1;
+    }
+    wake_fd = wake_fds[1];
+
+    // stop without restarting interrupted system calls
+    struct sigaction stop_action;
+    std::memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = request_stop;
+    sigemptyset(&stop_action.sa_mask);
+    ::sigaction(SIGINT, &stop_action, nullptr);
+    ::sigaction(SIGTERM, &stop_action, nullptr);
+
+    serve_socket(listen_fd, wake_fds[0], n_threads, idf_model, top_k,
+                 options);
+
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+    ::close(wake_fds[0]);
+    ::close(wake_fds[1]);
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <utility>
 
 ir::RawDocument ir::parse_doc_file(std::istream& input_stream) {
@@ -35,3 +36,363 @@ ir::docs_from_files(const std::vector<std::string>& file_list) {
 
     return result;
 };
+
+namespace {
+
+/**
+ * @brief A minimal reader of JSON values from a string.
+ *
+ * Only the values needed by ir::parse_json_doc are decoded; all other values
+ * are validated and skipped.
+ */
+class JsonReader {
+  public:
+    /**
+     * @brief Deepest nesting of arrays and objects skipped by skip_value.
+     */
+    static const size_t MaxDepth = 64;
+
+    /**
+     * @brief Construct a reader of the given text.
+     */
+    explicit JsonReader(std::string_view text) : m_text(text) {}
+
+    /**
+     * @brief Skip whitespace and return the next character without consuming
+     * it; '\0' at the end of the text.
+     */
+    char peek() {
+        while (m_pos < m_text.size() && is_space(m_text[m_pos])) {
+            ++m_pos;
+        }
+        return m_pos < m_text.size() ? m_text[m_pos] : '\0';
+    }
+
+    /**
+     * @brief Consume the given character after whitespace.
+     *
+     * @throw std::runtime_error if the next character is different.
+     */
+    void expect(char c) {
+        if (peek() != c) {
+            fail(std::string("expected '") + c + "'");
+        }
+        ++m_pos;
+    }
+
+    /**
+     * @brief Consume the given character after whitespace if it is next.
+     *
+     * @return true if the character was consumed; false, otherwise.
+     */
+    bool accept(char c) {
+        if (peek() != c) {
+            return false;
+        }
+        ++m_pos;
+        return true;
+    }
+
+    /**
+     * @brief Check that only whitespace is left.
+     */
+    void expect_end() {
+        if (peek() != '\0') {
+            fail("unexpected trailing characters");
+        }
+    }
+
+    /**
+     * @brief Read a string and store it in UTF-8.
+     */
+    void read_string(std::string& str) {
+        str.clear();
+        expect('"');
+        while (true) {
+            if (m_pos >= m_text.size()) {
+                fail("unterminated string");
+            }
+            const char c = m_text[m_pos++];
+            if (c == '"') {
+                return;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                fail("control character in string");
+            }
+            if (c != '\\') {
+                str.push_back(c);
+                continue;
+            }
+
+            if (m_pos >= m_text.size()) {
+                fail("unterminated string");
+            }
+            switch (m_text[m_pos++]) {
+            case '"':
+                str.push_back('"');
+                break;
+            case '\\':
+                str.push_back('\\');
+                break;
+            case '/':
+                str.push_back('/');
+                break;
+            case 'b':
+                str.push_back('\b');
+                break;
+            case 'f':
+                str.push_back('\f');
+                break;
+            case 'n':
+                str.push_back('\n');
+                break;
+            case 'r':
+                str.push_back('\r');
+                break;
+            case 't':
+                str.push_back('\t');
+                break;
+            case 'u':
+                append_utf8(str, read_code_point());
+                break;
+            default:
+                fail("invalid escape sequence");
+            }
+        }
+    }
+
+    /**
+     * @brief Read a number and return it as it is written.
+     */
+    std::string_view read_number() {
+        const size_t begin = m_pos;
+        accept('-');
+        if (not read_digits()) {
+            fail("invalid number");
+        }
+        if (m_pos < m_text.size() && m_text[m_pos] == '.') {
+            ++m_pos;
+            if (not read_digits()) {
+                fail("invalid number");
+            }
+        }
+        if (m_pos < m_text.size() &&
+            (m_text[m_pos] == 'e' || m_text[m_pos] == 'E')) {
+            ++m_pos;
+            if (m_pos < m_text.size() &&
+                (m_text[m_pos] == '+' || m_text[m_pos] == '-')) {
+                ++m_pos;
+            }
+            if (not read_digits()) {
+                fail("invalid number");
+            }
+        }
+        return m_text.substr(begin, m_pos - begin);
+    }
+
+    /**
+     * @brief Skip a value of any type.
+     *
+     * @param depth Number of arrays and objects enclosing the value.
+     *
+     * @throw std::runtime_error if arrays and objects are nested deeper than
+     * MaxDepth, so that malicious input can't exhaust the stack.
+     */
+    void skip_value(size_t depth = 0) {
+        if (depth > MaxDepth) {
+            fail("values nested too deeply");
+        }
+        std::string scratch;
+        const char c = peek();
+        if (c == '"') {
+            read_string(scratch);
+        } else if (c == '{') {
+            ++m_pos;
+            if (accept('}')) {
+                return;
+            }
+            do {
+                read_string(scratch);
+                expect(':');
+                skip_value(depth + 1);
+            } while (accept(','));
+            expect('}');
+        } else if (c == '[') {
+            ++m_pos;
+            if (accept(']')) {
+                return;
+            }
+            do {
+                skip_value(depth + 1);
+            } while (accept(','));
+            expect(']');
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            read_number();
+        } else if (not(read_literal("true") || read_literal("false") ||
+                       read_literal("null"))) {
+            fail("invalid value");
+        }
+    }
+
+    /**
+     * @brief Throw an error describing the current position.
+     */
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("Invalid JSON document at offset " +
+                                 std::to_string(m_pos) + ": " + message);
+    }
+
+  private:
+    /**
+     * @brief Return whether the given character is JSON whitespace.
+     */
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    /**
+     * @brief Consume a nonempty sequence of digits.
+     *
+     * @return false if there is no digit; true, otherwise.
+     */
+    bool read_digits() {
+        const size_t begin = m_pos;
+        while (m_pos < m_text.size() && m_text[m_pos] >= '0' &&
+               m_text[m_pos] <= '9') {
+            ++m_pos;
+        }
+        return m_pos > begin;
+    }
+
+    /**
+     * @brief Consume the given literal if it is next.
+     */
+    bool read_literal(std::string_view literal) {
+        if (m_text.substr(m_pos, literal.size()) != literal) {
+            return false;
+        }
+        m_pos += literal.size();
+        return true;
+    }
+
+    /**
+     * @brief Read the 4 hexadecimal digits of a \\u escape.
+     */
+    unsigned read_hex4() {
+        if (m_pos + 4 > m_text.size()) {
+            fail("invalid unicode escape");
+        }
+        unsigned result = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            const char c = m_text[m_pos++];
+            result <<= 4;
+            if (c >= '0' && c <= '9') {
+                result |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                result |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                result |= c - 'A' + 10;
+            } else {
+                fail("invalid unicode escape");
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Read the code point of a \\u escape whose backslash and u are
+     * consumed, combining surrogate pairs.
+     */
+    unsigned read_code_point() {
+        const unsigned high = read_hex4();
+        if (high < 0xD800 || high > 0xDFFF) {
+            return high;
+        }
+        if (high > 0xDBFF || not read_literal("\\u")) {
+            fail("invalid surrogate pair");
+        }
+        const unsigned low = read_hex4();
+        if (low < 0xDC00 || low > 0xDFFF) {
+            fail("invalid surrogate pair");
+        }
+        return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    /**
+     * @brief Append the UTF-8 encoding of the given code point.
+     */
+    static void append_utf8(std::string& str, unsigned code_point) {
+        if (code_point < 0x80) {
+            str.push_back(static_cast<char>(code_point));
+        } else if (code_point < 0x800) {
+            str.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            str.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else if (code_point < 0x10000) {
+            str.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+            str.push_back(
+                static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            str.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else {
+            str.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+            str.push_back(
+                static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+            str.push_back(
+                static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            str.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+    }
+
+    /**
+     * @brief Text to read.
+     */
+    std::string_view m_text;
+
+    /**
+     * @brief Position of the next unread character.
+     */
+    size_t m_pos = 0;
+};
+
+} // namespace
+
+ir::RawDocument ir::parse_json_doc(std::string_view line, std::string& id) {
+    JsonReader reader(line);
+    RawDocument result;
+    bool has_sentences = false;
+    id.clear();
+
+    std::string key;
+    reader.expect('{');
+    if (not reader.accept('}')) {
+        do {
+            reader.read_string(key);
+            reader.expect(':');
+            if (key == "sentences") {
+                result.sentences.clear();
+                reader.expect('[');
+                if (not reader.accept(']')) {
+                    do {
+                        result.sentences.emplace_back();
+                        reader.read_string(result.sentences.back());
+                    } while (reader.accept(','));
+                    reader.expect(']');
+                }
+                has_sentences = true;
+            } else if (key == "id" && reader.peek() == '"') {
+                reader.read_string(id);
+            } else if (key == "id") {
+                id = reader.read_number();
+            } else {
+                reader.skip_value();
+            }
+        } while (reader.accept(','));
+        reader.expect('}');
+    }
+    reader.expect_end();
+
+    if (not has_sentences) {
+        reader.fail("missing \"sentences\" member");
+    }
+
+    return result;
+}
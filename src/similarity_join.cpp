@@ -0,0 +1,381 @@
+#include "similarity_join.hpp"
+#include "perfect_hash_set.hpp"
+#include "vector_space_model.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Slack subtracted from the threshold in the pruning bounds so that
+ * rounding errors never prune a pair whose similarity reaches the threshold.
+ */
+static const double BoundSlack = 1e-9;
+
+/**
+ * @brief The constant pi.
+ */
+static const double Pi = 3.14159265358979323846;
+
+/**
+ * @brief An (index, value) pair.
+ */
+struct Posting {
+    /**
+     * @brief Feature index of a row entry, or row index of a posting.
+     */
+    std::uint32_t index;
+
+    /**
+     * @brief Value of the entry.
+     */
+    double value;
+};
+
+/**
+ * @brief Map the given term IDs to dense feature indices.
+ *
+ * @param terms Term IDs of all entries of some rows.
+ * @param feature_of Feature index of each entry is stored here.
+ * @return Number of distinct features.
+ */
+static size_t map_features(const std::vector<ir::term_id>& terms,
+                           std::vector<std::uint32_t>& feature_of) {
+    std::vector<ir::term_id> features(terms);
+    std::sort(features.begin(), features.end());
+    features.erase(std::unique(features.begin(), features.end()),
+                   features.end());
+
+    feature_of.resize(terms.size());
+    for (size_t k = 0; k < terms.size(); ++k) {
+        const auto it =
+            std::lower_bound(features.begin(), features.end(), terms[k]);
+        feature_of[k] = static_cast<std::uint32_t>(it - features.begin());
+    }
+
+    return features.size();
+}
+
+ir::AdjacencyMatrix ir::similarity_join(const SparseRows<double>& vecs,
+                                        double threshold) {
+    assert(threshold > 0);
+
+    const size_t n = vecs.rows();
+    const auto& offsets = vecs.offsets();
+    const std::vector<term_id>& terms = vecs.terms();
+    const std::vector<double>& values = vecs.values();
+
+    // count and maximum value of each feature
+    std::vector<std::uint32_t> feature_of;
+    const size_t n_features = map_features(terms, feature_of);
+    std::vector<size_t> row_count(n_features, 0);
+    std::vector<double> max_value(n_features, 0);
+    for (size_t k = 0; k < terms.size(); ++k) {
+        const std::uint32_t f = feature_of[k];
+        ++row_count[f];
+        max_value[f] = std::max(max_value[f], values[k]);
+    }
+
+    // rank features from the most frequent to the least frequent
+    std::vector<std::uint32_t> by_count(n_features);
+    std::iota(by_count.begin(), by_count.end(), 0);
+    std::stable_sort(by_count.begin(), by_count.end(),
+                     [&row_count](std::uint32_t left, std::uint32_t right) {
+                         return row_count[left] > row_count[right];
+                     });
+    std::vector<std::uint32_t> rank(n_features);
+    for (size_t r = 0; r < n_features; ++r) {
+        rank[by_count[r]] = static_cast<std::uint32_t>(r);
+    }
+
+    // entries of each row in feature rank order, and maximum value of rows
+    std::vector<Posting> entries(terms.size());
+    std::vector<double> row_max(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+            entries[k] = Posting{feature_of[k], values[k]};
+            row_max[i] = std::max(row_max[i], values[k]);
+        }
+        std::sort(entries.begin() + offsets[i],
+                  entries.begin() + offsets[i + 1],
+                  [&rank](const Posting& left, const Posting& right) {
+                      return rank[left.index] < rank[right.index];
+                  });
+    }
+
+    // process rows with large maximum values first
+    std::vector<std::uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&row_max](std::uint32_t left, std::uint32_t right) {
+                         return row_max[left] > row_max[right];
+                     });
+
+    AdjacencyMatrix result(n);
+    std::vector<std::vector<Posting>> index(n_features);
+    std::vector<double> prefix_bound(n, 0);
+    std::vector<double> dot(n, 0);
+    std::vector<char> is_candidate(n, 0);
+    std::vector<std::uint32_t> candidates;
+
+    const double bound_threshold = threshold - BoundSlack;
+    for (const std::uint32_t x : order) {
+        if (row_max[x] == 0) {
+            continue;
+        }
+        const SparseRow<double> x_row = vecs.row(x);
+        const double min_size_root = bound_threshold / row_max[x];
+        const double min_size = min_size_root * min_size_root;
+
+        // accumulate dot products with the indexed part of previous rows
+        for (size_t k = offsets[x]; k < offsets[x + 1]; ++k) {
+            const Posting& entry = entries[k];
+            for (const Posting& posting : index[entry.index]) {
+                const std::uint32_t y = posting.index;
+                if (static_cast<double>(offsets[y + 1] - offsets[y]) <
+                    min_size) {
+                    continue;
+                }
+                if (not is_candidate[y]) {
+                    is_candidate[y] = 1;
+                    candidates.push_back(y);
+                }
+                dot[y] += entry.value * posting.value;
+            }
+        }
+
+        // verify the candidates that can still reach the threshold
+        for (const std::uint32_t y : candidates) {
+            if (dot[y] + prefix_bound[y] >= bound_threshold &&
+                cosine_sim(x_row, vecs.row(y)) >= threshold) {
+                result.set(x, y);
+            }
+            dot[y] = 0;
+            is_candidate[y] = 0;
+        }
+        candidates.clear();
+
+        // index the entries after the prefix that can't reach the threshold
+        double bound = 0;
+        size_t k = offsets[x];
+        for (; k < offsets[x + 1]; ++k) {
+            const Posting& entry = entries[k];
+            const double next_bound =
+                bound + entry.value * max_value[entry.index];
+            if (next_bound >= bound_threshold) {
+                break;
+            }
+            bound = next_bound;
+        }
+        prefix_bound[x] = bound;
+        for (; k < offsets[x + 1]; ++k) {
+            index[entries[k].index].push_back(Posting{x, entries[k].value});
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Return a standard normal sample determined by the given seed, term
+ * and hyperplane.
+ *
+ * Two uniform samples are derived by hashing, and transformed to a normal
+ * sample using the Box-Muller transform. Hence, the hyperplanes don't have to
+ * be stored, and the same term has the same projection in every document.
+ */
+static double gaussian(std::uint64_t seed, ir::term_id term, size_t plane) {
+    const std::uint64_t key =
+        ir::mix64(seed ^ ir::mix64((std::uint64_t(term) << 32) ^ plane));
+    const std::uint64_t other = ir::mix64(key ^ 0x9e3779b97f4a7c15ull);
+    // uniform samples in (0, 1] and [0, 1)
+    const double u1 = (static_cast<double>(key >> 11) + 1) * 0x1.0p-53;
+    const double u2 = static_cast<double>(other >> 11) * 0x1.0p-53;
+    return std::sqrt(-2 * std::log(u1)) * std::cos(2 * Pi * u2);
+}
+
+/**
+ * @brief Sort the given rows into buckets of identical band keys, and store
+ * the range of the rows following each row in its bucket.
+ *
+ * Rows in a bucket larger than max_bucket are split further by the keys of
+ * the following bands, cyclically, until every bucket is small enough or
+ * all band keys of its rows are the same. Hence, the number of candidate
+ * pairs of a row in a band is at most max_bucket, unless the row has the
+ * same sketch as more rows. Rows of a bucket are sorted in increasing order.
+ *
+ * @param band_keys Key of each band of each row, row-major.
+ * @param n_bands Number of bands.
+ * @param band Band whose buckets are computed.
+ * @param depth Number of bands, starting from band, whose keys are already
+ * the same for all rows in [begin, end).
+ * @param max_bucket Largest bucket that isn't split.
+ * @param rows Rows of the band; [begin, end) is reordered.
+ * @param begin Beginning of the rows to sort.
+ * @param end End of the rows to sort.
+ * @param next Position of the row following each row in its bucket.
+ * @param bucket_end End of the bucket of each row in rows.
+ */
+static void split_buckets(const std::vector<std::uint64_t>& band_keys,
+                          size_t n_bands, size_t band, size_t depth,
+                          size_t max_bucket, std::uint32_t* rows,
+                          size_t begin, size_t end,
+                          std::uint32_t* next, std::uint32_t* bucket_end) {
+    const size_t key_band = (band + depth) % n_bands;
+    const auto key = [&band_keys, n_bands, key_band](std::uint32_t row) {
+        return band_keys[row * n_bands + key_band];
+    };
+    std::sort(rows + begin, rows + end,
+              [&key](std::uint32_t left, std::uint32_t right) {
+                  return key(left) < key(right) ||
+                         (key(left) == key(right) && left < right);
+              });
+
+    for (size_t first = begin, last; first < end; first = last) {
+        last = first + 1;
+        while (last < end && key(rows[last]) == key(rows[first])) {
+            ++last;
+        }
+        if (last - first > max_bucket && depth + 1 < n_bands) {
+            split_buckets(band_keys, n_bands, band, depth + 1, max_bucket,
+                          rows, first, last, next, bucket_end);
+            continue;
+        }
+        for (size_t s = first; s < last; ++s) {
+            next[rows[s]] = static_cast<std::uint32_t>(s + 1);
+            bucket_end[rows[s]] = static_cast<std::uint32_t>(last);
+        }
+    }
+}
+
+ir::AdjacencyMatrix
+ir::approximate_similarity_join(const SparseRows<double>& vecs,
+                                double threshold, const LshOptions& options,
+                                LshStats* stats) {
+    assert(threshold > 0);
+    assert(options.rows >= 1 && options.rows <= 64);
+
+    const size_t n = vecs.rows();
+    const auto& offsets = vecs.offsets();
+    const std::vector<term_id>& terms = vecs.terms();
+    const std::vector<double>& values = vecs.values();
+    const size_t n_planes = options.bands * options.rows;
+
+    // random hyperplane coordinates of each distinct term, feature-major
+    std::vector<std::uint32_t> feature_of;
+    const size_t n_features = map_features(terms, feature_of);
+    std::vector<double> planes(n_features * n_planes);
+    std::vector<char> has_coords(n_features, 0);
+    for (size_t k = 0; k < terms.size(); ++k) {
+        if (not has_coords[feature_of[k]]) {
+            has_coords[feature_of[k]] = 1;
+            double* coords = &planes[feature_of[k] * n_planes];
+            for (size_t p = 0; p < n_planes; ++p) {
+                coords[p] = gaussian(options.seed, terms[k], p);
+            }
+        }
+    }
+
+    // sketch bit p of a row is the sign of its projection onto plane p
+    std::vector<double> projection(n_planes);
+    std::vector<std::uint64_t> band_keys(n * options.bands, 0);
+    for (size_t i = 0; i < n; ++i) {
+        std::fill(projection.begin(), projection.end(), 0);
+        for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+            const double* coords = &planes[feature_of[k] * n_planes];
+            for (size_t p = 0; p < n_planes; ++p) {
+                projection[p] += values[k] * coords[p];
+            }
+        }
+        for (size_t p = 0; p < n_planes; ++p) {
+            if (projection[p] > 0) {
+                band_keys[i * options.bands + p / options.rows] |=
+                    std::uint64_t(1) << (p % options.rows);
+            }
+        }
+    }
+
+    // rows of each band sorted into buckets of identical band keys
+    const size_t n_bands = options.bands;
+    std::vector<std::uint32_t> members;
+    members.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (offsets[i + 1] > offsets[i]) {
+            members.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    const size_t n_members = members.size();
+    members.resize(n_bands * n_members);
+    std::vector<std::uint32_t> next(n_bands * n, 0);
+    std::vector<std::uint32_t> bucket_end(n_bands * n, 0);
+    for (size_t b = 0; b < n_bands; ++b) {
+        std::uint32_t* rows = members.data() + b * n_members;
+        std::copy(members.data(), members.data() + n_members, rows);
+        split_buckets(band_keys, n_bands, b, 0, options.max_bucket, rows, 0,
+                      n_members, &next[b * n], &bucket_end[b * n]);
+    }
+
+    // rows sharing a bucket in any band are candidates; each pair is verified
+    // once, when its smaller row is visited
+    AdjacencyMatrix result(n);
+    size_t n_candidates = 0;
+    std::vector<std::uint32_t> seen_by(n, std::uint32_t(n));
+    for (size_t i = 0; i + 1 < n; ++i) {
+        if (offsets[i + 1] == offsets[i]) {
+            continue;
+        }
+        for (size_t b = 0; b < n_bands; ++b) {
+            const std::uint32_t* bucket = &members[b * n_members];
+            for (size_t s = next[b * n + i]; s < bucket_end[b * n + i];
+                 ++s) {
+                const std::uint32_t j = bucket[s];
+                if (seen_by[j] == i) {
+                    continue;
+                }
+                seen_by[j] = static_cast<std::uint32_t>(i);
+                ++n_candidates;
+                if (cosine_sim(vecs.row(i), vecs.row(j)) >= threshold) {
+                    result.set(i, j);
+                }
+            }
+        }
+    }
+
+    if (stats == nullptr) {
+        return result;
+    }
+
+    *stats = LshStats();
+    stats->candidates = n_candidates;
+    stats->edges = result.entries() / 2;
+
+    // compare the exact neighbors of evenly spaced rows with the result
+    const size_t n_sample = std::min(options.recall_sample, n);
+    for (size_t s = 0; s < n_sample; ++s) {
+        const size_t i = s * n / n_sample;
+        for (size_t j = 0; j < n; ++j) {
+            if (j != i && cosine_sim(vecs.row(i), vecs.row(j)) >= threshold) {
+                ++stats->sample_edges;
+                stats->sample_found += result.test(i, j);
+            }
+        }
+    }
+    if (stats->sample_edges > 0) {
+        stats->recall = static_cast<double>(stats->sample_found) /
+                        static_cast<double>(stats->sample_edges);
+    }
+
+    return result;
+}
+
+double ir::lsh_candidate_probability(const LshOptions& options,
+                                     double similarity) {
+    const double bit_agreement = 1 - std::acos(similarity) / Pi;
+    const double band_agreement =
+        std::pow(bit_agreement, static_cast<double>(options.rows));
+    const double band_miss = 1 - band_agreement;
+    return 1 - std::pow(band_miss, static_cast<double>(options.bands));
+}
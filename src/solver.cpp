@@ -0,0 +1,292 @@
+#include "solver.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+double ir::residual(const Vector<double>& x, const Vector<double>& y,
+                    ResidualNorm norm) {
+    assert(x.size() == y.size());
+
+    double result = 0;
+    for (size_t i = 0; i < x.size(); ++i) {
+        const double diff = std::abs(x(i) - y(i));
+        if (norm == ResidualNorm::L1) {
+            result += diff;
+        } else {
+            result = std::max(result, diff);
+        }
+    }
+
+    return result;
+}
+
+ir::SolverStats ir::power_iteration(const TransitionMatrix& trans_mat,
+                                    Vector<double>& dist,
+                                    Vector<double>& scratch,
+                                    const SolverOptions& options) {
+    assert(dist.size() == trans_mat.size());
+    assert(scratch.size() == trans_mat.size());
+
+    SolverStats stats;
+    stats.method = SolverMethod::Power;
+    while (stats.iterations < options.max_iterations) {
+        // compute next distribution into the scratch buffer and make it the
+        // current one
+        trans_mat.multiply(dist, scratch);
+        std::swap(dist, scratch);
+        ++stats.iterations;
+
+        stats.residual = residual(dist, scratch, options.norm);
+        if (stats.residual <= options.tolerance) {
+            stats.converged = true;
+            break;
+        }
+    }
+
+    return stats;
+}
+
+/**
+ * @brief Return the sum of the entries of the given vector.
+ */
+static double sum(const ir::Vector<double>& x) {
+    double result = 0;
+    for (size_t i = 0; i < x.size(); ++i) {
+        result += x(i);
+    }
+    return result;
+}
+
+/**
+ * @brief Multiply every entry of the given vector so that it sums to target.
+ */
+static void rescale(ir::Vector<double>& x, double target) {
+    const double total = sum(x);
+    if (total == 0) {
+        return;
+    }
+    const double factor = target / total;
+    for (size_t i = 0; i < x.size(); ++i) {
+        x(i) *= factor;
+    }
+}
+
+ir::SolverStats ir::gauss_seidel(const TransitionMatrix& trans_mat,
+                                 Vector<double>& dist,
+                                 const SolverOptions& options) {
+    const size_t n = trans_mat.size();
+    assert(dist.size() == n);
+    assert(options.relaxation > 0 && options.relaxation < 2);
+
+    const double dist_sum = sum(dist);
+    const double link_weight = 1 - trans_mat.damping_factor();
+    const double teleport = trans_mat.damping_factor() * dist_sum / n;
+    const double omega = options.relaxation;
+
+    const auto& offsets = trans_mat.links().offsets();
+    const term_id* cols = trans_mat.links().terms().data();
+    const double* probs = trans_mat.links().values().data();
+
+    SolverStats stats;
+    stats.method = SolverMethod::GaussSeidel;
+    while (stats.iterations < options.max_iterations) {
+        double change = 0;
+        for (size_t i = 0; i < n; ++i) {
+            // split row i into the diagonal and the off-diagonal part
+            double diag = 0;
+            double off_diag_sum = 0;
+            for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+                if (cols[k] == i) {
+                    diag = probs[k];
+                } else {
+                    off_diag_sum += probs[k] * dist(cols[k]);
+                }
+            }
+
+            const double gs_value =
+                (teleport + link_weight * off_diag_sum) /
+                (1 - link_weight * diag);
+            const double value = (1 - omega) * dist(i) + omega * gs_value;
+
+            const double diff = std::abs(value - dist(i));
+            if (options.norm == ResidualNorm::L1) {
+                change += diff;
+            } else {
+                change = std::max(change, diff);
+            }
+            dist(i) = value;
+        }
+        ++stats.iterations;
+
+        stats.residual = change;
+        if (stats.residual <= options.tolerance) {
+            stats.converged = true;
+            break;
+        }
+    }
+
+    return stats;
+}
+
+ir::SolverStats ir::aitken_power_iteration(const TransitionMatrix& trans_mat,
+                                           Vector<double>& dist,
+                                           Vector<double>& scratch,
+                                           const SolverOptions& options) {
+    assert(dist.size() == trans_mat.size());
+    assert(scratch.size() == trans_mat.size());
+
+    const double dist_sum = sum(dist);
+    // dist, scratch and older hold the last three iterates from the newest
+    Vector<double> older(dist.size());
+
+    SolverStats stats;
+    stats.method = SolverMethod::Aitken;
+    while (stats.iterations < options.max_iterations) {
+        // compute the next iterate into the oldest buffer and rotate
+        trans_mat.multiply(dist, older);
+        std::swap(dist, older);
+        std::swap(scratch, older);
+        ++stats.iterations;
+
+        stats.residual = residual(dist, scratch, options.norm);
+        if (stats.residual <= options.tolerance) {
+            stats.converged = true;
+            break;
+        }
+
+        if (stats.iterations >= 2 && stats.iterations % AitkenPeriod == 0) {
+            for (size_t i = 0; i < dist.size(); ++i) {
+                const double step = dist(i) - scratch(i);
+                const double step_diff = step - (scratch(i) - older(i));
+                // skip components that have already converged
+                if (step_diff != 0) {
+                    const double value = dist(i) - step * step / step_diff;
+                    dist(i) = std::max(value, 0.0);
+                }
+            }
+            rescale(dist, dist_sum);
+        }
+    }
+
+    return stats;
+}
+
+ir::SolverStats ir::dense_lu(const TransitionMatrix& trans_mat,
+                             Vector<double>& dist, Vector<double>& scratch,
+                             const SolverOptions& options) {
+    const size_t n = trans_mat.size();
+    assert(dist.size() == n && scratch.size() == n);
+
+    const double dist_sum = sum(dist);
+    const double link_weight = 1 - trans_mat.damping_factor();
+
+    // A = I - (1 - d)P and b = ds/N
+    Matrix<double> a(n, n);
+    for (size_t i = 0; i < n; ++i) {
+        const auto row = trans_mat.links().row(i);
+        for (size_t k = 0; k < row.size(); ++k) {
+            a(i, row.term(k)) = -link_weight * row.value(k);
+        }
+        a(i, i) += 1;
+        dist(i) = trans_mat.damping_factor() * dist_sum / n;
+    }
+
+    // in-place LU decomposition with partial pivoting, applying the row
+    // swaps and the elimination to the right hand side as well
+    for (size_t k = 0; k < n; ++k) {
+        size_t pivot = k;
+        for (size_t i = k + 1; i < n; ++i) {
+            if (std::abs(a(i, k)) > std::abs(a(pivot, k))) {
+                pivot = i;
+            }
+        }
+        if (pivot != k) {
+            for (size_t j = 0; j < n; ++j) {
+                std::swap(a(k, j), a(pivot, j));
+            }
+            std::swap(dist(k), dist(pivot));
+        }
+
+        for (size_t i = k + 1; i < n; ++i) {
+            const double factor = a(i, k) / a(k, k);
+            if (factor == 0) {
+                continue;
+            }
+            for (size_t j = k + 1; j < n; ++j) {
+                a(i, j) -= factor * a(k, j);
+            }
+            dist(i) -= factor * dist(k);
+        }
+    }
+
+    // back substitution
+    for (size_t i = n; i-- > 0;) {
+        double value = dist(i);
+        for (size_t j = i + 1; j < n; ++j) {
+            value -= a(i, j) * dist(j);
+        }
+        dist(i) = value / a(i, i);
+    }
+
+    SolverStats stats;
+    stats.method = SolverMethod::DenseLU;
+    stats.iterations = 1;
+    trans_mat.multiply(dist, scratch);
+    stats.residual = residual(dist, scratch, options.norm);
+    stats.converged = stats.residual <= options.tolerance;
+
+    return stats;
+}
+
+ir::SolverMethod ir::choose_solver(const TransitionMatrix& trans_mat) {
+    const size_t n = trans_mat.size();
+    if (n <= DenseSolverMaxSize) {
+        return SolverMethod::DenseLU;
+    }
+
+    const double density =
+        static_cast<double>(trans_mat.links_size()) / (double(n) * n);
+    if (density > DenseGraphDensity) {
+        return SolverMethod::Aitken;
+    }
+
+    return SolverMethod::GaussSeidel;
+}
+
+ir::SolverStats ir::solve(const TransitionMatrix& trans_mat,
+                          Vector<double>& dist, Vector<double>& scratch,
+                          const SolverOptions& options) {
+    SolverMethod method = options.method;
+    if (method == SolverMethod::Auto) {
+        method = choose_solver(trans_mat);
+    }
+
+    switch (method) {
+    case SolverMethod::GaussSeidel:
+        return gauss_seidel(trans_mat, dist, options);
+    case SolverMethod::Aitken:
+        return aitken_power_iteration(trans_mat, dist, scratch, options);
+    case SolverMethod::DenseLU:
+        return dense_lu(trans_mat, dist, scratch, options);
+    default:
+        return power_iteration(trans_mat, dist, scratch, options);
+    }
+}
+
+ir::SolverMethod ir::solver_method_from_name(const std::string& name) {
+    if (name == "power") {
+        return SolverMethod::Power;
+    } else if (name == "gauss-seidel") {
+        return SolverMethod::GaussSeidel;
+    } else if (name == "aitken") {
+        return SolverMethod::Aitken;
+    } else if (name == "lu") {
+        return SolverMethod::DenseLU;
+    } else if (name == "auto") {
+        return SolverMethod::Auto;
+    }
+
+    throw std::invalid_argument("Unknown solver method " + name);
+}
@@ -0,0 +1,129 @@
+#include "summarizer.hpp"
+#include "lexrank.hpp"
+#include "tokenizer.hpp"
+#include "vocabulary.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+ir::Summary ir::summarize(const RawDocument& raw_doc,
+                          const IdfModel& idf_model, size_t top_k,
+                          const LexrankOptions& options) {
+    // model terms have the same IDs in every document, so their tokens are
+    // cached across all documents summarized by this thread
+    thread_local TermCache cache;
+    return summarize(raw_doc, idf_model, top_k, options, cache);
+}
+
+ir::Summary ir::summarize(const RawDocument& raw_doc,
+                          const IdfModel& idf_model, size_t top_k,
+                          const LexrankOptions& options, TermCache& cache) {
+    // terms missing from the model are kept local to this document
+    Vocabulary vocab(idf_model);
+    return summarize(normalize_document(raw_doc, vocab, cache), idf_model,
+                     top_k, options);
+}
+
+ir::Summary ir::summarize(const NormalizedDocument& norm_doc,
+                          const IdfModel& idf_model, size_t top_k,
+                          const LexrankOptions& options) {
+    Summary summary;
+    summary.scores = lexrank(norm_doc, idf_model, options, &summary.stats);
+
+    // sort sentence indices with respect to lexrank
+    std::vector<size_t> indices(summary.scores.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::stable_sort(indices.begin(), indices.end(),
+                     [&summary](size_t left, size_t right) {
+                         return summary.scores[left] > summary.scores[right];
+                     });
+
+    indices.resize(std::min(top_k, indices.size()));
+    summary.top_sentences = std::move(indices);
+
+    return summary;
+}
+
+std::ostream& ir::write_summary(std::ostream& os, const Summary& summary,
+                                const RawDocument& raw_doc) {
+    // output lexrank scores
+    for (const double score : summary.scores) {
+        os << std::fixed << std::setprecision(6) << score << '\n';
+    }
+    os << '\n';
+
+    // output summary sentences
+    for (const size_t index : summary.top_sentences) {
+        os << raw_doc.sentences[index] << '\n';
+    }
+
+    return os;
+}
+
+std::ostream& ir::write_json_string(std::ostream& os, std::string_view str) {
+    static const char hex_digits[] = "0123456789abcdef";
+
+    os << '"';
+    for (const char c : str) {
+        switch (c) {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        case '\n':
+            os << "\\n";
+            break;
+        case '\r':
+            os << "\\r";
+            break;
+        case '\t':
+            os << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                os << "\\u00" << hex_digits[(c >> 4) & 0xF]
+                   << hex_digits[c & 0xF];
+            } else {
+                os << c;
+            }
+        }
+    }
+    return os << '"';
+}
+
+std::ostream& ir::write_summary_json(std::ostream& os, std::string_view id,
+                                     const Summary& summary,
+                                     const RawDocument& raw_doc) {
+    os << "{\"id\":";
+    write_json_string(os, id);
+
+    os << ",\"scores\":[";
+    for (size_t i = 0; i < summary.scores.size(); ++i) {
+        os << (i == 0 ? "" : ",") << std::fixed << std::setprecision(6)
+           << summary.scores[i];
+    }
+
+    os << "],\"summary\":[";
+    for (size_t i = 0; i < summary.top_sentences.size(); ++i) {
+        os << (i == 0 ? "" : ",") << summary.top_sentences[i];
+    }
+
+    os << "],\"sentences\":[";
+    for (size_t i = 0; i < summary.top_sentences.size(); ++i) {
+        os << (i == 0 ? "" : ",");
+        write_json_string(os, raw_doc.sentences[summary.top_sentences[i]]);
+    }
+
+    return os << "]}\n";
+}
+
+std::ostream& ir::write_error_json(std::ostream& os, std::string_view id,
+                                   std::string_view message) {
+    os << "{\"id\":";
+    write_json_string(os, id);
+    os << ",\"error\":";
+    write_json_string(os, message);
+    return os << "}\n";
+}
@@ -0,0 +1,48 @@
+#include "term_cache.hpp"
+#include "idf_model.hpp"
+#include "tokenizer.hpp"
+#include <functional>
+
+ir::TermCache::TermCache(size_t n_slots) {
+    size_t size = 1;
+    while (size < n_slots) {
+        size <<= 1;
+    }
+    m_slots.resize(size);
+}
+
+ir::term_id ir::TermCache::lookup(std::string_view token, Vocabulary& vocab) {
+    // layered vocabularies share the IDs of their base model
+    const IdfModel* base = vocab.base();
+    const std::uint64_t id_space = vocab.id_space();
+    if (id_space != m_id_space) {
+        clear();
+        m_id_space = id_space;
+    }
+
+    const size_t hash = std::hash<std::string_view>()(token);
+    Slot& slot = m_slots[hash & (m_slots.size() - 1)];
+    if (slot.used && slot.token == token) {
+        ++m_hits;
+        return slot.id;
+    }
+    ++m_misses;
+
+    normalize(token, m_term);
+    const term_id id = m_term.empty() ? InvalidTermID : vocab.intern(m_term);
+
+    // terms local to a layered vocabulary get different IDs in each one
+    if (base == nullptr || id == InvalidTermID || id < vocab.base_size()) {
+        slot.token.assign(token.data(), token.size());
+        slot.id = id;
+        slot.used = true;
+    }
+
+    return id;
+}
+
+void ir::TermCache::clear() {
+    for (Slot& slot : m_slots) {
+        slot.used = false;
+    }
+}
@@ -0,0 +1,68 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <utility>
+
+ir::ThreadPool::ThreadPool(size_t n_threads) {
+    if (n_threads == 0) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workers.reserve(n_threads);
+    for (size_t i = 0; i < n_threads; ++i) {
+        m_workers.emplace_back([this] { work(); });
+    }
+}
+
+ir::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_task_cv.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ir::ThreadPool::submit(task t) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(t));
+        ++m_pending;
+    }
+    m_task_cv.notify_one();
+}
+
+void ir::ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this] { return m_pending == 0; });
+}
+
+void ir::ThreadPool::work() {
+    while (true) {
+        task t;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+
+            // finish the remaining tasks before exiting
+            if (m_tasks.empty()) {
+                return;
+            }
+
+            t = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        t();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+            if (m_pending == 0) {
+                m_done_cv.notify_all();
+            }
+        }
+    }
+}
@@ -1,81 +1,152 @@
 #include "tokenizer.hpp"
-#include "util.hpp"
+#include "porter_stemmer.hpp"
+#include "stopwords.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
 #include <cstring>
 #include <file_manager.hpp>
 #include <fstream>
 #include <iostream>
 #include <numeric>
-
-// tell the compiler that stem will be externally linked
-extern int stem(char* p, int i, int j);
+#include <stdexcept>
 
 std::vector<std::string> ir::tokenize(const std::string& str) {
-    std::string str_copy(str);
+    std::vector<std::string> result;
+    for_each_token(str, [&result](std::string_view token) {
+        result.emplace_back(token);
+    });
 
-    return split(str_copy, " \t\n\r\v\f");
+    return result;
 }
 
-std::string ir::remove_punctuation(const std::string& token) {
-    std::string result(token);
+/**
+ * @brief Return whether the given character is removed from anywhere in a
+ * token.
+ */
+static bool is_removed_punct(const char c) {
+    return c == '"' || c == ',' || c == '<' || c == '>' || c == '\'';
+}
 
-    // remove certain puncts from anywhere in the word
-    std::replace(result.begin(), result.end(), '\"', '\'');
-    std::replace(result.begin(), result.end(), ',', '\'');
-    std::replace(result.begin(), result.end(), '<', '\'');
-    std::replace(result.begin(), result.end(), '>', '\'');
-    result.erase(std::remove(result.begin(), result.end(), '\''), result.end());
+/**
+ * @brief Return whether the given character is alphanumeric.
+ */
+static bool is_alnum(const char c) {
+    return std::isalnum(static_cast<unsigned char>(c));
+}
 
-    if (result.empty()) {
-        return result;
+/**
+ * @brief Write the given token with punctuation removed as specified in
+ * ir::normalize to out, optionally converting it to lowercase.
+ *
+ * Characters removed from anywhere in the token are never alphanumeric, so
+ * stripping the punctuation at both ends amounts to keeping the characters
+ * between the first and the last alphanumeric ones. Hence, the token is read
+ * only once.
+ *
+ * @param token Input token.
+ * @param out String to store the result; its capacity is reused.
+ * @param lowercase Whether to convert the characters to lowercase.
+ */
+static void strip_punctuation(std::string_view token, std::string& out,
+                              bool lowercase) {
+    out.clear();
+
+    size_t first = 0;
+    while (first < token.size() && !is_alnum(token[first])) {
+        ++first;
     }
-
-    // iterate as long as current char is not alphanumeric and not '
-    // (' will be removed)
-    auto to_remove = [](const char c) { return c != '\'' && !isalnum(c); };
-    // remove any kind of punct from the start and end of the word
-    for (size_t i = 0; i < result.size() && to_remove(result[i]); ++i) {
-        result[i] = '\'';
+    size_t last = token.size();
+    while (last > first && !is_alnum(token[last - 1])) {
+        --last;
     }
-    for (int i = result.size() - 1; i >= 0 && to_remove(result[i]); --i) {
-        result[i] = '\'';
+
+    for (size_t i = first; i < last; ++i) {
+        const char c = token[i];
+        if (is_removed_punct(c)) {
+            continue;
+        }
+        out.push_back(lowercase ? std::tolower(static_cast<unsigned char>(c))
+                                : c);
     }
-    result.erase(std::remove(result.begin(), result.end(), '\''), result.end());
+}
+
+std::string ir::remove_punctuation(const std::string& token) {
+    std::string result;
+    strip_punctuation(token, result, false);
 
     return result;
 }
 
-bool ir::is_stopword(const std::string& word) {
-    static std::vector<std::string> stopwords;
+/**
+ * @brief Sorted stopword list read by ir::load_stopwords.
+ */
+static std::vector<std::string> custom_stopwords;
 
-    // if calling for the first time
-    if (stopwords.empty()) {
-        std::ifstream ifs(ir::STOPWORD_PATH);
-        std::string stopword;
-        while (ifs >> stopword) {
-            stopwords.push_back(stopword);
-        }
-        assert(!stopwords.empty());
+/**
+ * @brief Whether custom_stopwords is used instead of the default stopwords.
+ */
+static std::atomic<bool> use_custom_stopwords(false);
+
+void ir::load_stopwords(const std::string& filepath) {
+    std::ifstream ifs(filepath);
+    if (!ifs) {
+        throw std::runtime_error("Couldn't open stopword file " + filepath);
+    }
+
+    std::vector<std::string> stopwords;
+    std::string stopword;
+    while (ifs >> stopword) {
+        stopwords.push_back(stopword);
+    }
+    std::sort(stopwords.begin(), stopwords.end());
 
+    custom_stopwords = std::move(stopwords);
+    use_custom_stopwords.store(true, std::memory_order_release);
+}
+
+std::uint64_t ir::stopwords_fingerprint() {
+    std::vector<std::string_view> stopwords;
+    if (use_custom_stopwords.load(std::memory_order_acquire)) {
+        stopwords.assign(custom_stopwords.begin(), custom_stopwords.end());
+    } else {
+        stopwords.assign(DefaultStopwords.begin(), DefaultStopwords.end());
         std::sort(stopwords.begin(), stopwords.end());
     }
 
-    return std::binary_search(stopwords.begin(), stopwords.end(), word);
+    // hash the words separated by spaces, which can't occur in a word
+    std::string joined;
+    for (const auto word : stopwords) {
+        joined.append(word).push_back(' ');
+    }
+    return fnv1a64(joined);
 }
 
-std::string ir::normalize(const std::string& token) {
-    // remove punctuation using heuristics
-    std::string result = remove_punctuation(token);
-    // convert string to lowercase
-    std::transform(result.begin(), result.end(), result.begin(), tolower);
+bool ir::is_stopword(std::string_view word) {
+    if (use_custom_stopwords.load(std::memory_order_acquire)) {
+        return std::binary_search(custom_stopwords.begin(),
+                                  custom_stopwords.end(), word);
+    }
+
+    return DefaultStopwordSet.contains(word);
+}
+
+void ir::normalize(std::string_view token, std::string& term) {
+    // remove punctuation using heuristics and convert to lowercase
+    strip_punctuation(token, term, true);
     // if string is a stopword, return empty string
-    if (is_stopword(result)) {
-        return "";
+    if (is_stopword(term)) {
+        term.clear();
+        return;
     }
-    // stem the word
-    auto word_end = static_cast<size_t>(stem(&result[0], 0, result.size() - 1));
-    result = result.substr(0, word_end + 1);
+    // stem the word in-place
+    term.resize(ir::stem(term, &term[0]));
+}
+
+std::string ir::normalize(const std::string& token) {
+    std::string result;
+    normalize(token, result);
 
     return result;
 }
@@ -89,36 +160,85 @@ void ir::normalize_all(std::vector<std::string>& token_vec) {
                     token_vec.end());
 }
 
-ir::NormalizedDocument ir::normalize_document(const ir::RawDocument& raw_doc) {
+/**
+ * @brief Tokenize the given raw document and store the term counts of each
+ * sentence using the given function to map tokens to term IDs.
+ *
+ * @param raw_doc Document to normalize.
+ * @param token_id Function returning the term ID of a raw token, or
+ * ir::InvalidTermID if the token normalizes to nothing.
+ * @return Normalized version of the given raw document.
+ */
+template <typename TokenToID>
+static ir::NormalizedDocument
+normalize_document_with(const ir::RawDocument& raw_doc, TokenToID token_id) {
     ir::NormalizedDocument norm_doc;
+    auto& term_counts = norm_doc.sentence_term_counts;
+
+    // term IDs of the current sentence; reused for every sentence
+    std::vector<ir::term_id> ids;
     for (const auto& sentence : raw_doc.sentences) {
-        auto tokens = tokenize(sentence);
-        normalize_all(tokens);
-        if (tokens.empty()) {
+        ids.clear();
+        ir::for_each_token(sentence, [&ids, &token_id](std::string_view token) {
+            const ir::term_id id = token_id(token);
+            if (id != ir::InvalidTermID) {
+                ids.push_back(id);
+            }
+        });
+        if (ids.empty()) {
             continue;
         }
 
-        std::sort(tokens.begin(), tokens.end());
-        norm_doc.sentence_term_counts.emplace_back();
-        for (const auto& term : tokens) {
-            ++norm_doc.sentence_term_counts.back()[term];
+        // equal IDs are consecutive after sorting; store each with its count
+        std::sort(ids.begin(), ids.end());
+        for (size_t i = 0; i < ids.size();) {
+            size_t run_end = i + 1;
+            while (run_end < ids.size() && ids[run_end] == ids[i]) {
+                ++run_end;
+            }
+            term_counts.push_back(ids[i], run_end - i);
+            i = run_end;
         }
+        term_counts.end_row();
     }
 
     return norm_doc;
 }
 
+ir::NormalizedDocument ir::normalize_document(const ir::RawDocument& raw_doc,
+                                              Vocabulary& vocab) {
+    // normalized term of the current token; reused for every token
+    std::string term;
+    return normalize_document_with(
+        raw_doc, [&vocab, &term](std::string_view token) {
+            normalize(token, term);
+            return term.empty() ? InvalidTermID : vocab.intern(term);
+        });
+}
+
+ir::NormalizedDocument ir::normalize_document(const ir::RawDocument& raw_doc,
+                                              Vocabulary& vocab,
+                                              TermCache& cache) {
+    return normalize_document_with(
+        raw_doc, [&vocab, &cache](std::string_view token) {
+            return cache.lookup(token, vocab);
+        });
+}
+
 std::unordered_map<size_t, ir::NormalizedDocument>
 ir::normalized_docs_from_raw_docs(
-    const std::unordered_map<size_t, ir::RawDocument>& raw_docs) {
+    const std::unordered_map<size_t, ir::RawDocument>& raw_docs,
+    Vocabulary& vocab) {
 
     std::unordered_map<size_t, ir::NormalizedDocument> result;
+    // tokens repeat across documents, so share one cache for the corpus
+    TermCache cache;
     // normalize each document
     for (const auto& doc_pair : raw_docs) {
         size_t id = doc_pair.first;
         const auto& doc = doc_pair.second;
 
-        result[id] = ir::normalize_document(doc);
+        result[id] = ir::normalize_document(doc, vocab, cache);
     }
 
     return result;
@@ -0,0 +1,36 @@
+#include "transition_matrix.hpp"
+#include <cassert>
+
+void ir::TransitionMatrix::multiply(const Vector<double>& x,
+                                    Vector<double>& y) const {
+    const size_t n = size();
+    assert(x.size() == n && y.size() == n);
+    assert(&x != &y && "Transition matrix can't be multiplied in-place");
+
+    // teleportation contributes the same amount to every state
+    double x_sum = 0;
+    for (size_t j = 0; j < n; ++j) {
+        x_sum += x(j);
+    }
+    const double teleport = m_damping_factor / n * x_sum;
+    const double link_weight = 1 - m_damping_factor;
+
+    const auto& offsets = m_links.offsets();
+    const term_id* cols = m_links.terms().data();
+    const double* probs = m_links.values().data();
+    for (size_t i = 0; i < n; ++i) {
+        double link_sum = 0;
+        for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+            link_sum += probs[k] * x(cols[k]);
+        }
+        y(i) = link_weight * link_sum + teleport;
+    }
+}
+
+ir::Vector<double> ir::operator*(const TransitionMatrix& matrix,
+                                 const Vector<double>& vector) {
+    Vector<double> result(matrix.size());
+    matrix.multiply(vector, result);
+
+    return result;
+}
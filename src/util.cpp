@@ -5,12 +5,14 @@ std::vector<std::string> ir::split(std::string& str,
                                    const std::string& delimeters) {
     std::vector<std::string> result;
 
-    // find the first token
-    char* token = strtok(&str[0], delimeters.c_str());
+    // strtok_r keeps its position in save_ptr instead of a static, so
+    // different threads can split strings concurrently
+    char* save_ptr = nullptr;
+    char* token = strtok_r(&str[0], delimeters.c_str(), &save_ptr);
     while (token != nullptr) {
         // end of the first token is replaced with \0 already.
         result.emplace_back(token);
-        token = strtok(nullptr, delimeters.c_str());
+        token = strtok_r(nullptr, delimeters.c_str(), &save_ptr);
     }
 
     return result;
@@ -1,71 +1,130 @@
 #include "vector_space_model.hpp"
 #include "util.hpp"
-#include <unordered_set>
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <stdexcept>
 
-std::unordered_map<std::string, double> ir::idf_scores(
-    const std::unordered_map<size_t, ir::NormalizedDocument>& document_corpus) {
-    std::unordered_map<std::string, double> result;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief If the longer of two vectors has at least this many times more
+ * entries than the shorter one, ir::sparse_dot uses galloping search.
+ */
+static const size_t GallopSizeRatio = 16;
+
+/**
+ * @brief If both vectors have at least this many entries, ir::sparse_dot uses
+ * the SIMD intersection kernel.
+ */
+static const size_t SimdMinSize = 16;
+
+ir::OovPolicy ir::oov_policy_from_name(const std::string& name) {
+    if (name == "ignore") {
+        return OovPolicy::Ignore;
+    } else if (name == "error") {
+        return OovPolicy::Error;
+    } else if (name == "max-idf") {
+        return OovPolicy::MaxIdf;
+    }
+
+    throw std::invalid_argument("Unknown OOV policy " + name);
+}
+
+std::vector<double> ir::idf_scores(
+    const std::unordered_map<size_t, ir::NormalizedDocument>& document_corpus,
+    size_t n_terms) {
+    std::vector<double> result(n_terms, 0);
+
+    // index of the last document each term is counted for, so that every term
+    // is counted at most once per document
+    std::vector<size_t> last_doc(n_terms, document_corpus.size());
 
     // store counts for each document
+    size_t doc_index = 0;
     for (const auto& doc_pair : document_corpus) {
         const auto& doc = doc_pair.second;
 
-        // store which words occur in current document
-        std::unordered_set<std::string> doc_words;
-        for (const auto& sentence : doc.sentence_term_counts) {
-            for (const auto& word_pair : sentence) {
-                const auto& word = word_pair.first;
-                doc_words.insert(word);
+        // increment count of each occurring word
+        for (const term_id word : doc.sentence_term_counts.terms()) {
+            assert(word < n_terms && "Term ID out of vocabulary range");
+
+            if (last_doc[word] != doc_index) {
+                last_doc[word] = doc_index;
+                ++result[word];
             }
         }
 
-        // increment count of each occurring word
-        for (const auto& word : doc_words) {
-            ++result[word];
-        }
+        ++doc_index;
     }
 
     size_t n_docs = document_corpus.size();
     // calculate idf scores
-    for (auto& term_pair : result) {
-        double doc_freq = term_pair.second;
+    for (double& score : result) {
+        double doc_freq = score;
         double idf = std::log10(n_docs / doc_freq);
 
-        term_pair.second = idf;
+        score = idf;
     }
 
     return result;
 };
 
-std::vector<std::unordered_map<std::string, double>>
-ir::tf_idf_maps(const ir::NormalizedDocument& norm_doc,
-                const std::unordered_map<std::string, double>& idf_scores) {
-    std::vector<std::unordered_map<std::string, double>> result;
-    for (const auto& sentence : norm_doc.sentence_term_counts) {
-        result.emplace_back();
+ir::SparseRows<double>
+ir::tf_idf_vectors(const ir::NormalizedDocument& norm_doc,
+                   const IdfModel& idf_model, OovPolicy oov) {
+    const auto& term_counts = norm_doc.sentence_term_counts;
+
+    SparseRows<double> result;
+    result.reserve(term_counts.rows(), term_counts.entries());
+
+    // nonzero entries of the current sentence; reused for every sentence
+    std::vector<std::pair<term_id, double>> entries;
+    for (size_t i = 0; i < term_counts.rows(); ++i) {
+        const auto sentence = term_counts.row(i);
 
-        for (const auto& term_pair : sentence) {
-            const std::string& term = term_pair.first;
-            size_t count = term_pair.second;
+        entries.clear();
+        double sq_len = 0;
+        for (size_t k = 0; k < sentence.size(); ++k) {
+            const term_id term = sentence.term(k);
+            size_t count = sentence.value(k);
+
+            // terms missing from the model are dropped before any weight is
+            // computed unless the policy says otherwise
+            const bool oov_term = term >= idf_model.size();
+            if (oov_term && oov == OovPolicy::Ignore) {
+                continue;
+            }
 
             double tf = (count > 0) ? (1 + std::log10(count)) : 0;
-            double idf = idf_scores.at(term);
+            double idf = (oov_term && oov == OovPolicy::MaxIdf)
+                             ? idf_model.oov_idf()
+                             : idf_model.idf(term);
 
             double tfidf = tf * idf;
             if (not close(tfidf, 0.0)) {
-                result.back()[term] = tfidf;
+                entries.emplace_back(term, tfidf);
+                sq_len += tfidf * tfidf;
             }
         }
+
+        // scale to unit length once so that cosine is a plain dot product
+        const double len = std::sqrt(sq_len);
+        for (const auto& entry : entries) {
+            result.push_back(entry.first, entry.second / len);
+        }
+        result.end_row();
     }
 
     return result;
 }
 
-double ir::euc_len(const std::unordered_map<std::string, double>& vec) {
+double ir::euc_len(const SparseRow<double>& vec) {
     double result = 0;
-    for (const auto& pair : vec) {
-        double value = pair.second;
+    for (size_t k = 0; k < vec.size(); ++k) {
+        double value = vec.value(k);
 
         result += value * value;
     }
@@ -73,19 +132,163 @@ double ir::euc_len(const std::unordered_map<std::string, double>& vec) {
     return std::sqrt(result);
 }
 
-double ir::cosine_sim(const std::unordered_map<std::string, double>& vec1,
-                      const std::unordered_map<std::string, double>& vec2) {
+/**
+ * @brief Dot product of two sparse vectors using a scalar merge pass starting
+ * from the given positions.
+ *
+ * @param vec1 First vector.
+ * @param vec2 Second vector.
+ * @param i Start position in vec1.
+ * @param j Start position in vec2.
+ * @return Dot product of the suffixes of the given vectors.
+ */
+static double merge_dot(const ir::SparseRow<double>& vec1,
+                        const ir::SparseRow<double>& vec2, size_t i, size_t j) {
     double result = 0;
-    for (const auto& term_pair : vec1) {
-        const auto& term = term_pair.first;
-        const double tfidf1 = term_pair.second;
-
-        // if term occurs in both maps
-        if (vec2.find(term) != vec2.end()) {
-            const double tfidf2 = vec2.at(term);
-            result += tfidf1 * tfidf2;
+    while (i < vec1.size() && j < vec2.size()) {
+        const ir::term_id term1 = vec1.term(i);
+        const ir::term_id term2 = vec2.term(j);
+
+        if (term1 < term2) {
+            ++i;
+        } else if (term2 < term1) {
+            ++j;
+        } else {
+            // term occurs in both vectors
+            result += vec1.value(i) * vec2.value(j);
+            ++i;
+            ++j;
         }
     }
 
-    return result / (euc_len(vec1) * euc_len(vec2));
+    return result;
+}
+
+/**
+ * @brief Dot product of a short and a long sparse vector using galloping
+ * search.
+ *
+ * For each term of the short vector, the search range in the long vector is
+ * doubled until it passes the term, and then the term is binary searched in
+ * the last range. Search always resumes from the last found position.
+ *
+ * @param small Shorter vector.
+ * @param large Longer vector.
+ * @return Dot product of the given vectors.
+ */
+static double gallop_dot(const ir::SparseRow<double>& small,
+                         const ir::SparseRow<double>& large) {
+    const ir::term_id* terms = large.terms();
+    const size_t n = large.size();
+
+    double result = 0;
+    size_t pos = 0;
+    for (size_t i = 0; i < small.size() && pos < n; ++i) {
+        const ir::term_id term = small.term(i);
+
+        // find a range [pos, hi) whose last element is not less than term
+        size_t step = 1;
+        size_t hi = pos + 1;
+        while (hi < n && terms[hi - 1] < term) {
+            pos = hi;
+            step *= 2;
+            hi = std::min(n, pos + step);
+        }
+
+        pos = std::lower_bound(terms + pos, terms + hi, term) - terms;
+        if (pos < n && terms[pos] == term) {
+            result += small.value(i) * large.value(pos);
+            ++pos;
+        }
+    }
+
+    return result;
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Dot product of two sparse vectors where common terms are found by
+ * comparing blocks of 4 term IDs from each vector at once.
+ *
+ * Each block of vec1 is compared against all 4 rotations of a block of vec2.
+ * The block with the smaller last term is advanced (both are advanced if the
+ * last terms are equal). The remaining tails are merged by merge_dot.
+ *
+ * @param vec1 First vector.
+ * @param vec2 Second vector.
+ * @return Dot product of the given vectors.
+ */
+static double simd_dot(const ir::SparseRow<double>& vec1,
+                       const ir::SparseRow<double>& vec2) {
+    const ir::term_id* terms1 = vec1.terms();
+    const ir::term_id* terms2 = vec2.terms();
+
+    double result = 0;
+    size_t i = 0, j = 0;
+    while (i + 4 <= vec1.size() && j + 4 <= vec2.size()) {
+        const __m128i block1 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(terms1 + i));
+        const __m128i block2 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(terms2 + j));
+
+        // compare block1 with every rotation of block2
+        __m128i eq = _mm_cmpeq_epi32(block1, block2);
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(block1, _mm_shuffle_epi32(
+                                                          block2, 0x39)));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(block1, _mm_shuffle_epi32(
+                                                          block2, 0x4e)));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(block1, _mm_shuffle_epi32(
+                                                          block2, 0x93)));
+
+        // bit p is set if terms1[i + p] occurs in the block of vec2
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        while (mask != 0) {
+            const int p = __builtin_ctz(mask);
+            mask &= mask - 1;
+
+            const ir::term_id term = terms1[i + p];
+            size_t q = j;
+            while (terms2[q] != term) {
+                ++q;
+            }
+            result += vec1.value(i + p) * vec2.value(q);
+        }
+
+        const ir::term_id last1 = terms1[i + 3];
+        const ir::term_id last2 = terms2[j + 3];
+        if (last1 <= last2) {
+            i += 4;
+        }
+        if (last2 <= last1) {
+            j += 4;
+        }
+    }
+
+    return result + merge_dot(vec1, vec2, i, j);
+}
+#endif
+
+double ir::sparse_dot(const SparseRow<double>& vec1,
+                      const SparseRow<double>& vec2) {
+    const auto& small = (vec1.size() <= vec2.size()) ? vec1 : vec2;
+    const auto& large = (vec1.size() <= vec2.size()) ? vec2 : vec1;
+
+    if (small.empty()) {
+        return 0;
+    }
+    if (large.size() >= GallopSizeRatio * small.size()) {
+        return gallop_dot(small, large);
+    }
+#if defined(__SSE2__)
+    if (small.size() >= SimdMinSize) {
+        return simd_dot(vec1, vec2);
+    }
+#endif
+    return merge_dot(vec1, vec2, 0, 0);
+}
+
+double ir::cosine_sim(const SparseRow<double>& vec1,
+                      const SparseRow<double>& vec2) {
+    // vectors are unit length; see ir::tf_idf_vectors
+    return sparse_dot(vec1, vec2);
 }
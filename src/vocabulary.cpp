@@ -0,0 +1,49 @@
+#include "vocabulary.hpp"
+#include "idf_model.hpp"
+#include <cassert>
+
+ir::Vocabulary::Vocabulary(const IdfModel& base)
+    : m_base(&base), m_base_size(base.size()) {}
+
+ir::term_id ir::Vocabulary::intern(const std::string& term) {
+    term_id id = find(term);
+    if (id != InvalidTermID) {
+        return id;
+    }
+
+    assert(size() < InvalidTermID && "Vocabulary is full");
+
+    id = static_cast<term_id>(size());
+    m_ids.emplace(term, id);
+    m_terms.push_back(term);
+
+    return id;
+}
+
+ir::term_id ir::Vocabulary::find(const std::string& term) const {
+    if (m_base != nullptr) {
+        const term_id id = m_base->find(term);
+        if (id != InvalidTermID) {
+            return id;
+        }
+    }
+
+    auto it = m_ids.find(term);
+    if (it == m_ids.end()) {
+        return InvalidTermID;
+    }
+
+    return it->second;
+}
+
+std::string ir::Vocabulary::term(term_id id) const {
+    if (id < m_base_size) {
+        return m_base->term(id);
+    }
+
+    return m_terms[id - m_base_size];
+}
+
+std::uint64_t ir::Vocabulary::id_space() const {
+    return m_base != nullptr ? m_base->id_space() : m_id_space.generation();
+}